@@ -1,7 +1,15 @@
 #include "chunk.h"
+#include "condition_registry.h"
 
 Parser parser;
 Chunk* compiling_chunk;
+u8* compiling_source;
+CompileOptions compile_options;
+//NOTE: set by every parse function, true when the expression just compiled always produces an int
+b8 expression_is_int;
+//NOTE: the last condition load emitted, so == and != can find the condition their literal is checked against
+ConditionEntry* last_condition;
+i32 last_condition_offset = -1;
 
 inline Value BoolVal(b32 value) {
 	Value v = {
@@ -13,7 +21,7 @@ inline Value BoolVal(b32 value) {
 
 inline Value NilVal() {
 	Value v = {
-		.type = VAL_NUMBER,
+		.type = VAL_NIL,
 		.number = 0
 	};
 	return v;
@@ -27,15 +35,54 @@ inline Value NumberVal(f32 value) {
 	return v;
 }
 
-inline Value StringVal(u8* value) {
+inline Value IntVal(i64 value) {
+	Value v = {
+		.type = VAL_INT,
+		.integer = value
+	};
+	return v;
+}
+
+inline Value StringValN(u8* value, u32 length) {
 	Value v = {
 		.type = VAL_STRING,
+		.length = length,
 		.string = value
 	};
 	return v;
 }
 
-#define DEBUG_TRACE_EXEC
+inline Value StringVal(String value) {
+	return StringValN(value.data, value.length);
+}
+
+//NOTE: an int and a float are equal if they hold the same number
+b8 ValuesEqual(Value a, Value b) {
+	if (a.type != b.type) {
+		return IsNumeric(a) && IsNumeric(b) && AsNumeric(a) == AsNumeric(b);
+	}
+	switch (a.type) {
+		case VAL_BOOL:   return AsBool(a) == AsBool(b);
+		case VAL_NIL:    return true;
+		case VAL_NUMBER: return AsNumber(a) == AsNumber(b);
+		case VAL_INT:    return AsInt(a) == AsInt(b);
+		case VAL_STRING: return StringsEqual(AsStringView(a), AsStringView(b));
+		default:         return false;
+	}
+}
+
+//NOTE: -1, 0 or 1. Two ints compare exactly, anything involving a float compares as f64
+i32 CompareNumbers(Value a, Value b) {
+	if (IsInt(a) && IsInt(b)) {
+		return (AsInt(a) > AsInt(b)) - (AsInt(a) < AsInt(b));
+	}
+	f64 x = AsNumeric(a);
+	f64 y = AsNumeric(b);
+	return (x > y) - (x < y);
+}
+
+//NOTE: tracing logs every instruction run, only turn it on for short scripts
+//#define DEBUG_TRACE_EXEC
 #define DEBUG_PRINT_CODE
 
 void WriteChunk(Chunk* chunk, u8 byte, i32 line) {
@@ -61,7 +108,10 @@ void PrintValue(Value value) {
 			DDEBUGN("%.3f", AsNumber(value));
 		} break;
 		case VAL_STRING: {
-			DDEBUGN("%s", AsString(value));
+			DDEBUGN("%.*s", AsStringLength(value), AsString(value));
+		} break;
+		case VAL_INT: {
+			DDEBUGN("%lld", (long long)AsInt(value));
 		} break;
 		default:
 			DDEBUGN("Unknown ValueType");
@@ -82,6 +132,25 @@ i32 ConstantInstruction(char* name, Chunk* chunk, i32 offset) {
 	return offset + 2;
 }
 
+i32 ByteInstruction(char* name, Chunk* chunk, i32 offset) {
+	u8 operand = *(chunk->code + offset + 1);
+	DDEBUGN("%-16s %4d\n", name, operand);
+	return offset + 2;
+}
+
+i32 ConditionInstruction(char* name, Chunk* chunk, i32 offset) {
+	u8 table = *(chunk->code + offset + 1);
+	u16 slot = (u16)(*(chunk->code + offset + 2) << 8) | *(chunk->code + offset + 3);
+	DDEBUGN("%-16s %4d %4d\n", name, table, slot);
+	return offset + 4;
+}
+
+i32 JumpInstruction(char* name, i32 sign, Chunk* chunk, i32 offset) {
+	u16 jump = (u16)(*(chunk->code + offset + 1) << 8) | *(chunk->code + offset + 2);
+	DDEBUGN("%-16s %4d -> %d\n", name, offset, offset + 3 + sign * jump);
+	return offset + 3;
+}
+
 i32 DisassembleInstruction(Chunk* chunk, i32 offset) {
 	DDEBUGN("%04d ", offset);
 	if (offset > 0 && *(chunk->lines + offset) == *(chunk->lines + offset - 1)) {
@@ -93,6 +162,22 @@ i32 DisassembleInstruction(Chunk* chunk, i32 offset) {
 	switch (instruction) {
 		case OP_CONSTANT:
 			return ConstantInstruction("OP_CONSTANT", chunk, offset);
+		case OP_NIL:
+			return SimpleInstruction("OP_NIL", offset);
+		case OP_TRUE:
+			return SimpleInstruction("OP_TRUE", offset);
+		case OP_FALSE:
+			return SimpleInstruction("OP_FALSE", offset);
+		case OP_POP:
+			return SimpleInstruction("OP_POP", offset);
+		case OP_GET_CONDITION:
+			return ConditionInstruction("OP_GET_CONDITION", chunk, offset);
+		case OP_EQUAL:
+			return SimpleInstruction("OP_EQUAL", offset);
+		case OP_GREATER:
+			return SimpleInstruction("OP_GREATER", offset);
+		case OP_LESS:
+			return SimpleInstruction("OP_LESS", offset);
 		case OP_ADD:
 			return SimpleInstruction("OP_ADD", offset);
 		case OP_SUBTRACT:
@@ -101,8 +186,30 @@ i32 DisassembleInstruction(Chunk* chunk, i32 offset) {
 			return SimpleInstruction("OP_MULTIPLY", offset);
 		case OP_DIVIDE:
 			return SimpleInstruction("OP_DIVIDE", offset);
+		case OP_EQUAL_INT:
+			return SimpleInstruction("OP_EQUAL_INT", offset);
+		case OP_GREATER_INT:
+			return SimpleInstruction("OP_GREATER_INT", offset);
+		case OP_LESS_INT:
+			return SimpleInstruction("OP_LESS_INT", offset);
+		case OP_ADD_INT:
+			return SimpleInstruction("OP_ADD_INT", offset);
+		case OP_SUBTRACT_INT:
+			return SimpleInstruction("OP_SUBTRACT_INT", offset);
+		case OP_MULTIPLY_INT:
+			return SimpleInstruction("OP_MULTIPLY_INT", offset);
+		case OP_DIVIDE_INT:
+			return SimpleInstruction("OP_DIVIDE_INT", offset);
+		case OP_NOT:
+			return SimpleInstruction("OP_NOT", offset);
 		case OP_NEGATE:
 			return SimpleInstruction("OP_NEGATE", offset);
+		case OP_JUMP:
+			return JumpInstruction("OP_JUMP", 1, chunk, offset);
+		case OP_JUMP_IF_FALSE:
+			return JumpInstruction("OP_JUMP_IF_FALSE", 1, chunk, offset);
+		case OP_PROFILE:
+			return ByteInstruction("OP_PROFILE", chunk, offset);
 		case OP_RETURN:
 			return SimpleInstruction("OP_RETURN", offset);
 		default:
@@ -143,12 +250,39 @@ void InitChunk(MemoryArena* memory, Chunk* chunk) {
 	chunk->capacity = DEFAULT_CHUNK_SIZE;
 	chunk->lines = (i32*)PushArray(memory, DEFAULT_CHUNK_SIZE, i32);
 	InitValueArray(memory, &chunk->constants);
+	chunk->profile = PushArray(memory, DEFAULT_PROFILE_CAPACITY, ConditionProfile);
+	chunk->profile_count = 0;
+	chunk->profile_capacity = DEFAULT_PROFILE_CAPACITY;
 }
 
-void InitVM(VM* vm) {
+i32 FindConditionProfile(Chunk* chunk, u32 chain, u32 operand) {
+	for (i32 i = 0; i < chunk->profile_count; i++) {
+		ConditionProfile* entry = chunk->profile + i;
+		if (entry->chain == chain && entry->operand == operand) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+i32 AddConditionProfile(Chunk* chunk, u32 chain, u32 operand, u32 cost) {
+	i32 slot = FindConditionProfile(chunk, chain, operand);
+	if (slot < 0) {
+		DASSERT(chunk->profile_count + 1 <= chunk->profile_capacity);
+		slot = chunk->profile_count++;
+		chunk->profile[slot] = {chain, operand, cost, 0, 0};
+	}
+	return slot;
+}
+
+void InitVM(VM* vm, ConditionTables* tables = 0) {
 	vm->chunk = 0;
+	vm->tables = tables;
+	vm->snapshot = 0;
 	vm->ip = 0;
 	vm->stack_top = vm->stack;
+	vm->result = NilVal();
+	vm->print_results = true;
 }
 
 void ResetStack(VM* vm) {
@@ -165,14 +299,79 @@ Value Pop(VM* vm) {
 	return *(vm->stack_top);
 }
 
+Value PeekStack(VM* vm, i32 distance) {
+	return *(vm->stack_top - 1 - distance);
+}
+
+b8 IsFalsey(Value value) {
+	return IsNil(value) || (IsBool(value) && !AsBool(value));
+}
+
+void RuntimeError(VM* vm, char* message) {
+	i32 instruction = (i32)(vm->ip - vm->chunk->code - 1);
+	DERROR("[line %d] %s", *(vm->chunk->lines + instruction), message);
+	ResetStack(vm);
+}
+
 InterpretResult Run(VM* vm) {
 #define READ_BYTE() (*vm->ip++)
+#define READ_SHORT() (vm->ip += 2, (u16)((*(vm->ip - 2) << 8) | *(vm->ip - 1)))
 #define READ_CONSTANT() (*(vm->chunk->constants.values + READ_BYTE()))
-#define BINARY_OP(op) \
+//NOTE: two ints stay ints, an int mixed with a float is promoted. Int add, subtract and multiply wrap
+//on overflow, they're done on u64 where wrapping is defined and give the same bits as two's complement.
+#define WRAPPING(a, op, b) ((i64)((u64)(a) op (u64)(b)))
+#define BINARY_OP(value_type, int_type, op) \
 	do { \
-		f32 b = AsNumber(Pop(vm)); \
-		f32 a = AsNumber(Pop(vm)); \
-		Push(vm, NumberVal(a op b)); \
+		Value b = Pop(vm); \
+		Value a = Pop(vm); \
+		if (IsInt(a) && IsInt(b)) { \
+			Push(vm, int_type(AsInt(a) op AsInt(b))); \
+		} else if (IsNumeric(a) && IsNumeric(b)) { \
+			Push(vm, value_type(AsNumeric(a) op AsNumeric(b))); \
+		} else { \
+			RuntimeError(vm, "Operands must be numbers."); \
+			return INTERPRET_RUNTIME_ERROR; \
+		} \
+	} while (false)
+#define ARITHMETIC_OP(op) \
+	do { \
+		Value b = Pop(vm); \
+		Value a = Pop(vm); \
+		if (IsInt(a) && IsInt(b)) { \
+			Push(vm, IntVal(WRAPPING(AsInt(a), op, AsInt(b)))); \
+		} else if (IsNumeric(a) && IsNumeric(b)) { \
+			Push(vm, NumberVal(AsNumeric(a) op AsNumeric(b))); \
+		} else { \
+			RuntimeError(vm, "Operands must be numbers."); \
+			return INTERPRET_RUNTIME_ERROR; \
+		} \
+	} while (false)
+#define INT_OP(value_type, op) \
+	do { \
+		i64 b = AsInt(Pop(vm)); \
+		i64 a = AsInt(Pop(vm)); \
+		Push(vm, value_type(a op b)); \
+	} while (false)
+#define INT_ARITHMETIC_OP(op) \
+	do { \
+		i64 b = AsInt(Pop(vm)); \
+		i64 a = AsInt(Pop(vm)); \
+		Push(vm, IntVal(WRAPPING(a, op, b))); \
+	} while (false)
+//NOTE: INT64_MIN / -1 doesn't fit in an i64 and traps on x86 like a division by zero does
+#define CHECK_INT_DIVISOR() \
+	do { \
+		if (IsInt(PeekStack(vm, 0)) && IsInt(PeekStack(vm, 1))) { \
+			i64 divisor = AsInt(PeekStack(vm, 0)); \
+			if (divisor == 0) { \
+				RuntimeError(vm, "Integer division by zero."); \
+				return INTERPRET_RUNTIME_ERROR; \
+			} \
+			if (divisor == -1 && AsInt(PeekStack(vm, 1)) == INT64_MIN) { \
+				RuntimeError(vm, "Integer division overflow."); \
+				return INTERPRET_RUNTIME_ERROR; \
+			} \
+		} \
 	} while (false)
 	
 	for (;;) {
@@ -192,27 +391,103 @@ InterpretResult Run(VM* vm) {
 				Value constant = READ_CONSTANT();
 				Push(vm, constant);
 			} break;
+			case OP_NIL:
+				Push(vm, NilVal()); break;
+			case OP_TRUE:
+				Push(vm, BoolVal(true)); break;
+			case OP_FALSE:
+				Push(vm, BoolVal(false)); break;
+			case OP_POP:
+				Pop(vm); break;
+			case OP_GET_CONDITION: {
+				ConditionTableType table = (ConditionTableType)READ_BYTE();
+				u16 slot = READ_SHORT();
+				ConditionRef condition = {table, slot};
+				Push(vm, vm->snapshot ? QuerySnapshotValue(vm->snapshot, condition) : QueryConditionValue(vm->tables, condition));
+			} break;
+			case OP_EQUAL: {
+				Value b = Pop(vm);
+				Value a = Pop(vm);
+				Push(vm, BoolVal(ValuesEqual(a, b)));
+			} break;
+			case OP_GREATER:
+				BINARY_OP(BoolVal, BoolVal, >); break;
+			case OP_LESS:
+				BINARY_OP(BoolVal, BoolVal, <); break;
 			case OP_ADD: 
-				BINARY_OP(+); break;
+				ARITHMETIC_OP(+); break;
 			case OP_SUBTRACT: 
-				BINARY_OP(-); break;
+				ARITHMETIC_OP(-); break;
 			case OP_MULTIPLY: 
-				BINARY_OP(*); break;
+				ARITHMETIC_OP(*); break;
 			case OP_DIVIDE: 
-				BINARY_OP(/); break;
+				CHECK_INT_DIVISOR();
+				BINARY_OP(NumberVal, IntVal, /); break;
+			case OP_EQUAL_INT:
+				INT_OP(BoolVal, ==); break;
+			case OP_GREATER_INT:
+				INT_OP(BoolVal, >); break;
+			case OP_LESS_INT:
+				INT_OP(BoolVal, <); break;
+			case OP_ADD_INT:
+				INT_ARITHMETIC_OP(+); break;
+			case OP_SUBTRACT_INT:
+				INT_ARITHMETIC_OP(-); break;
+			case OP_MULTIPLY_INT:
+				INT_ARITHMETIC_OP(*); break;
+			case OP_DIVIDE_INT:
+				CHECK_INT_DIVISOR();
+				INT_OP(IntVal, /); break;
+			case OP_NOT:
+				Push(vm, BoolVal(IsFalsey(Pop(vm)))); break;
 			case OP_NEGATE: {
-				(vm->stack_top-1)->number = -(vm->stack_top-1)->number;
+				Value* top = vm->stack_top - 1;
+				if (IsInt(*top)) {
+					top->integer = WRAPPING(0, -, top->integer);
+				} else if (IsNumber(*top)) {
+					top->number = -top->number;
+				} else {
+					RuntimeError(vm, "Operand must be a number.");
+					return INTERPRET_RUNTIME_ERROR;
+				}
+			} break;
+			case OP_JUMP: {
+				u16 offset = READ_SHORT();
+				vm->ip += offset;
+			} break;
+			case OP_JUMP_IF_FALSE: {
+				u16 offset = READ_SHORT();
+				if (IsFalsey(PeekStack(vm, 0))) {
+					vm->ip += offset;
+				}
+			} break;
+			case OP_PROFILE: {
+				ConditionProfile* entry = vm->chunk->profile + READ_BYTE();
+				if (IsFalsey(PeekStack(vm, 0))) {
+					entry->fail++;
+				} else {
+					entry->pass++;
+				}
 			} break;
 			case OP_RETURN: {
-				PrintValue(Pop(vm));
-				DDEBUGN("\n");
+				vm->result = Pop(vm);
+				if (vm->print_results) {
+					PrintValue(vm->result);
+					DDEBUGN("\n");
+				}
 				return INTERPRET_OK;
 			}
 		}
 	}
 #undef READ_CONSTANT
+#undef READ_SHORT
 #undef READ_BYTE
+#undef WRAPPING
 #undef BINARY_OP
+#undef ARITHMETIC_OP
+#undef INT_OP
+#undef INT_ARITHMETIC_OP
+#undef CHECK_INT_DIVISOR
 }
 
 void ErrorAt(Token* token, u8* message) {
@@ -227,7 +502,7 @@ void ErrorAt(Token* token, u8* message) {
 
 	}
 	else {
-		DDEBUGN(" at '%.*s'", token->length, token->start);
+		DDEBUGN(" at '%.*s'", token->text.length, token->text.data);
 	}
 	DDEBUG(": %s", message);
 	parser.had_error = true;
@@ -248,7 +523,7 @@ void ParserAdvance() {
 		parser.current = ScanToken();
 		if (parser.current.type != TOKEN_ERROR)
 			break;
-		ErrorAtCurrent(parser.current.start);
+		ErrorAtCurrent(parser.current.text.data);
 	}
 }
 
@@ -273,6 +548,22 @@ void EmitBytes(u8 byte1, u8 byte2) {
 	EmitByte(byte2);
 }
 
+i32 EmitJump(u8 instruction) {
+	EmitByte(instruction);
+	EmitByte(0xff);
+	EmitByte(0xff);
+	return CurrentChunk()->count - 2;
+}
+
+void PatchJump(i32 offset) {
+	i32 jump = CurrentChunk()->count - offset - 2;
+	if (jump > UINT16_MAX) {
+		Error((u8*)"Too much code to jump over.");
+	}
+	*(CurrentChunk()->code + offset) = (jump >> 8) & 0xff;
+	*(CurrentChunk()->code + offset + 1) = jump & 0xff;
+}
+
 void EmitReturn() {
 	EmitByte(OP_RETURN);
 }
@@ -291,9 +582,13 @@ static ParseRule* GetRule(TokenTypeC type);
 static void ParsePrecedence(Precedence precedence);
 
 
-b8 Compile(u8* src, Chunk* chunk) {
+b8 Compile(u8* src, Chunk* chunk, CompileOptions* options = 0) {
 	InitScanner(src);
 	compiling_chunk = chunk;
+	compiling_source = src;
+	compile_options = options ? *options : CompileOptions{};
+	last_condition = 0;
+	last_condition_offset = -1;
 	parser.had_error = false;
 	parser.panic_mode = false;
 	ParserAdvance();
@@ -303,18 +598,26 @@ b8 Compile(u8* src, Chunk* chunk) {
 	return !parser.had_error;
 }
 
-InterpretResult Interpret(VM* vm, MemoryArena* memory, u8* src) {
+InterpretResult InterpretChunk(VM* vm, Chunk* chunk) {
+	vm->chunk = chunk;
+	vm->ip = vm->chunk->code;
+	InterpretResult result = Run(vm);
+	return result;
+}
+
+//NOTE: the chunk only lives for this call, everything pushed on memory while compiling is released
+//before returning. Domain values are kept in the registry's arena, so it can't be memory here.
+InterpretResult Interpret(VM* vm, MemoryArena* memory, u8* src, CompileOptions* options = 0) {
+	DASSERT(!options || !options->generate_domains || !options->registry || options->registry->memory != memory);
+	TempMemory temp = BeginTempMemory(memory);
 	Chunk chunk;
 	InitChunk(memory, &chunk);
 
-	if (!Compile(src, &chunk)) {
-		return INTERPRET_COMPILE_ERROR;
+	InterpretResult result = INTERPRET_COMPILE_ERROR;
+	if (Compile(src, &chunk, options)) {
+		result = InterpretChunk(vm, &chunk);
 	}
-	return INTERPRET_OK;
-
-	vm->chunk = &chunk;
-	vm->ip = vm->chunk->code;
-	InterpretResult result = Run(vm);
+	EndTempMemory(temp);
 	return result;
 }
 
@@ -356,9 +659,34 @@ void EmitConstant(Value value) {
 	EmitBytes(OP_CONSTANT, MakeConstant(value));
 }
 
+void ParserString() {
+	//NOTE: a view of the token's text between the quotes, nothing is copied
+	EmitConstant(StringVal(SubString(parser.previous.text, 1, parser.previous.text.length - 2)));
+	expression_is_int = false;
+}
+
 void ParserNumber() {
-	f32 value = StringToF32(parser.previous.start);
+	f32 value;
+	switch (ParseF32(parser.previous.text.data, parser.previous.text.length, &value)) {
+		case PARSE_NUMBER_OK: break;
+		case PARSE_NUMBER_INVALID: Error((u8*)"Invalid number."); break;
+		case PARSE_NUMBER_OUT_OF_RANGE: {
+			Error(value == 0.0f ? (u8*)"Number is too small for a float." : (u8*)"Number is too large for a float.");
+		} break;
+	}
 	EmitConstant(NumberVal(value));
+	expression_is_int = false;
+}
+
+void ParserInteger() {
+	i64 value;
+	switch (ParseI64(parser.previous.text.data, parser.previous.text.length, &value)) {
+		case PARSE_NUMBER_OK: break;
+		case PARSE_NUMBER_INVALID: Error((u8*)"Invalid integer."); break;
+		case PARSE_NUMBER_OUT_OF_RANGE: Error((u8*)"Integer is too large for 64 bits."); break;
+	}
+	EmitConstant(IntVal(value));
+	expression_is_int = true;
 }
 
 void Grouping() {
@@ -366,20 +694,150 @@ void Grouping() {
 	Consume(TOKEN_RIGHT_PAREN, (u8*)"Expect ') after expression.");
 }
 
+//NOTE: where the left operand of the infix rule being run started, And() needs it to rewind the chain
+struct OperandStart {
+	i32 code_offset;
+	i32 constant_count;
+	Token token;
+};
+OperandStart infix_left;
+
+//NOTE: condition names are resolved here, the bytecode only carries the table and slot
+void Condition() {
+	ConditionEntry* entry = 0;
+	if (compile_options.registry) {
+		entry = FindCondition(compile_options.registry, parser.previous.text);
+	}
+	if (!entry) {
+		Error((u8*)"Unknown condition.");
+		return;
+	}
+	if (entry->ref.id > UINT16_MAX) {
+		Error((u8*)"Condition slot out of range.");
+		return;
+	}
+	last_condition = entry;
+	last_condition_offset = CurrentChunk()->count;
+	expression_is_int = entry->ref.table == CONDITION_TABLE_INT || entry->ref.table == CONDITION_TABLE_CHAR;
+	EmitBytes(OP_GET_CONDITION, (u8)entry->ref.table);
+	EmitBytes((entry->ref.id >> 8) & 0xff, entry->ref.id & 0xff);
+}
+
+void Literal() {
+	switch (parser.previous.type) {
+		case TOKEN_FALSE: EmitByte(OP_FALSE); break;
+		case TOKEN_NIL: EmitByte(OP_NIL); break;
+		case TOKEN_TRUE: EmitByte(OP_TRUE); break;
+		default: return;
+	}
+	expression_is_int = false;
+}
+
 void Unary() {
 	TokenTypeC operator_type = parser.previous.type;
 	ParsePrecedence(PREC_UNARY);
 	switch (operator_type) {
+		case TOKEN_BANG: EmitByte(OP_NOT); expression_is_int = false; break;
 		case TOKEN_MINUS: EmitByte(OP_NEGATE); break;
 		default: return;
 	}
 }
 
+//NOTE: the condition loaded by the operand in [start, end), if that is all the operand does
+static ConditionEntry* LoneCondition(i32 start, i32 end) {
+	if (last_condition_offset == start && end - start == 4) {
+		return last_condition;
+	}
+	return 0;
+}
+
+static b8 ValueFitsCondition(ConditionEntry* entry, Value value) {
+	switch (entry->ref.table) {
+		case CONDITION_TABLE_BOOL: return IsBool(value);
+		case CONDITION_TABLE_CHAR:
+		case CONDITION_TABLE_INT: return IsInt(value);
+		case CONDITION_TABLE_FLOAT: return IsNumeric(value);
+		default: return IsString(value);
+	}
+}
+
+//NOTE: checks a literal compared against a condition with == or != is in the condition's domain,
+//or with generate_domains on adds it to the domain instead. A one character string compared to
+//a char condition is turned into the character's number, which is what the char table stores.
+static void CheckDomainValue(ConditionEntry* entry, i32 start, i32 end) {
+	Chunk* chunk = CurrentChunk();
+	Value value;
+	Value* constant = 0;
+	if (end - start == 2 && chunk->code[start] == OP_CONSTANT) {
+		constant = &chunk->constants.values[chunk->code[start + 1]];
+		value = *constant;
+	} else if (end - start == 1 && (chunk->code[start] == OP_TRUE || chunk->code[start] == OP_FALSE)) {
+		value = BoolVal(chunk->code[start] == OP_TRUE);
+	} else {
+		return;
+	}
+
+	if (constant && entry->ref.table == CONDITION_TABLE_CHAR && IsString(value) && AsStringLength(value) == 1) {
+		value = IntVal(AsString(value)[0]);
+		*constant = value;
+	} else if (constant && entry->ref.table == CONDITION_TABLE_FLOAT && IsInt(value)) {
+		value = NumberVal((f32)AsInt(value));
+		*constant = value;
+	}
+	if (!ValueFitsCondition(entry, value)) {
+		Error((u8*)"Value doesn't match the condition's type.");
+		return;
+	}
+	if (compile_options.generate_domains) {
+		AddDomainValueIfNew(compile_options.registry, entry, value);
+	} else if (entry->value_count > 0 && FindDomainValue(entry, value) < 0) {
+		Error((u8*)"Value is not in the condition's domain.");
+	}
+}
+
 void Binary() {
 	TokenTypeC operator_type = parser.previous.type;
+	i32 left_start = infix_left.code_offset;
+	i32 right_start = CurrentChunk()->count;
+	ConditionEntry* left_condition = LoneCondition(left_start, right_start);
+	b8 left_is_int = expression_is_int;
 	ParseRule* rule = GetRule(operator_type);
 	ParsePrecedence((Precedence)(rule->precedence + 1));
+	b8 both_int = left_is_int && expression_is_int;
+	if (operator_type == TOKEN_EQUAL_EQUAL || operator_type == TOKEN_BANG_EQUAL) {
+		i32 right_end = CurrentChunk()->count;
+		ConditionEntry* right_condition = LoneCondition(right_start, right_end);
+		if (left_condition) {
+			CheckDomainValue(left_condition, right_start, right_end);
+		} else if (right_condition) {
+			CheckDomainValue(right_condition, left_start, right_start);
+		}
+	}
+	if (both_int) {
+		switch (operator_type) {
+			case TOKEN_BANG_EQUAL: EmitBytes(OP_EQUAL_INT, OP_NOT); break;
+			case TOKEN_EQUAL_EQUAL: EmitByte(OP_EQUAL_INT); break;
+			case TOKEN_GREATER: EmitByte(OP_GREATER_INT); break;
+			case TOKEN_GREATER_EQUAL: EmitBytes(OP_LESS_INT, OP_NOT); break;
+			case TOKEN_LESS: EmitByte(OP_LESS_INT); break;
+			case TOKEN_LESS_EQUAL: EmitBytes(OP_GREATER_INT, OP_NOT); break;
+			case TOKEN_PLUS: EmitByte(OP_ADD_INT); return;
+			case TOKEN_MINUS: EmitByte(OP_SUBTRACT_INT); return;
+			case TOKEN_STAR: EmitByte(OP_MULTIPLY_INT); return;
+			case TOKEN_SLASH: EmitByte(OP_DIVIDE_INT); return;
+			default: break;
+		}
+		expression_is_int = false;
+		return;
+	}
+	expression_is_int = false;
 	switch (operator_type) {
+		case TOKEN_BANG_EQUAL: EmitBytes(OP_EQUAL, OP_NOT); break;
+		case TOKEN_EQUAL_EQUAL: EmitByte(OP_EQUAL); break;
+		case TOKEN_GREATER: EmitByte(OP_GREATER); break;
+		case TOKEN_GREATER_EQUAL: EmitBytes(OP_LESS, OP_NOT); break;
+		case TOKEN_LESS: EmitByte(OP_LESS); break;
+		case TOKEN_LESS_EQUAL: EmitBytes(OP_GREATER, OP_NOT); break;
 		case TOKEN_PLUS: EmitByte(OP_ADD); break;
 		case TOKEN_MINUS: EmitByte(OP_SUBTRACT); break;
 		case TOKEN_STAR: EmitByte(OP_MULTIPLY); break;
@@ -395,15 +853,135 @@ static void ParsePrecedence(Precedence precedence) {
 		Error((u8*)"Expect expression.");
 		return;
 	}
+	OperandStart left = {CurrentChunk()->count, CurrentChunk()->constants.count, parser.previous};
 	PrefixRule();
 
 	while (precedence <= GetRule(parser.current.type)->precedence) {
 		ParserAdvance();
 		ParseFn InfixRule = GetRule(parser.previous.type)->infix;
+		infix_left = left;
 		InfixRule();
 	}
 }
 
+static void EmitConditionProfile(u32 chain, u32 operand, u32 cost) {
+	if (compile_options.profile_conditions) {
+		i32 slot = AddConditionProfile(CurrentChunk(), chain, operand, cost);
+		if (slot > UINT8_MAX) {
+			Error((u8*)"Too many profiled conditions in one chunk.");
+			return;
+		}
+		EmitBytes(OP_PROFILE, (u8)slot);
+	}
+}
+
+//NOTE: orders a chain's operands by cost over failure rate so cheap tests that usually fail go first.
+//The +1/+2 keeps operands that never ran from dividing by zero. Returns false to keep source order.
+static b8 ReorderChain(u32 chain, u32 operand_count, u32* costs, u32* order) {
+	Chunk* profiled = compile_options.reorder_with;
+	if (!profiled) {
+		return false;
+	}
+	f32 ranks[MAX_CHAIN_OPERANDS];
+	for (u32 i = 0; i < operand_count; i++) {
+		i32 slot = FindConditionProfile(profiled, chain, i);
+		if (slot < 0) {
+			return false;
+		}
+		ConditionProfile* entry = profiled->profile + slot;
+		f32 fail_rate = (f32)(entry->fail + 1) / (f32)(entry->pass + entry->fail + 2);
+		ranks[i] = (f32)costs[i] / fail_rate;
+		order[i] = i;
+	}
+	b8 reordered = false;
+	for (u32 i = 1; i < operand_count; i++) {
+		u32 operand = order[i];
+		u32 j = i;
+		for (; j > 0 && ranks[order[j - 1]] > ranks[operand]; j--) {
+			order[j] = order[j - 1];
+			reordered = true;
+		}
+		order[j] = operand;
+	}
+	return reordered;
+}
+
+//NOTE: "and" chains are compiled whole so their operands can be reordered. Operands can't have side
+//effects yet, so every chain is commutative; that needs checking here once calls and assignment exist.
+static void And() {
+	OperandStart left = infix_left;
+	Chunk* chunk = CurrentChunk();
+	u32 chain = (u32)(left.token.text.data - compiling_source);
+	Token operand_tokens[MAX_CHAIN_OPERANDS];
+	u32 costs[MAX_CHAIN_OPERANDS];
+	i32 end_jumps[MAX_CHAIN_OPERANDS];
+
+	u32 operand_count = 1;
+	operand_tokens[0] = left.token;
+	costs[0] = chunk->count - left.code_offset;
+	EmitConditionProfile(chain, 0, costs[0]);
+	for (;;) {
+		if (operand_count == MAX_CHAIN_OPERANDS) {
+			Error((u8*)"Too many operands in one condition.");
+			return;
+		}
+		end_jumps[operand_count - 1] = EmitJump(OP_JUMP_IF_FALSE);
+		EmitByte(OP_POP);
+		operand_tokens[operand_count] = parser.current;
+		i32 code_start = chunk->count;
+		ParsePrecedence((Precedence)(PREC_AND + 1));
+		costs[operand_count] = chunk->count - code_start;
+		EmitConditionProfile(chain, operand_count, costs[operand_count]);
+		operand_count++;
+		if (parser.current.type != TOKEN_AND) {
+			break;
+		}
+		ParserAdvance();
+	}
+	for (u32 i = 0; i < operand_count - 1; i++) {
+		PatchJump(end_jumps[i]);
+	}
+	expression_is_int = false;
+
+	u32 order[MAX_CHAIN_OPERANDS];
+	if (parser.had_error || !ReorderChain(chain, operand_count, costs, order)) {
+		return;
+	}
+	//throw the chain away and compile it again from source in the new order
+	Scanner chain_end_scanner = scanner;
+	Parser chain_end_parser = parser;
+	chunk->count = left.code_offset;
+	chunk->constants.count = left.constant_count;
+	for (u32 i = 0; i < operand_count; i++) {
+		Token* operand = operand_tokens + order[i];
+		scanner.current = operand->text.data;
+		scanner.line = operand->line;
+		ParserAdvance();
+		ParsePrecedence((Precedence)(PREC_AND + 1));
+		EmitConditionProfile(chain, order[i], costs[order[i]]);
+		if (i < operand_count - 1) {
+			end_jumps[i] = EmitJump(OP_JUMP_IF_FALSE);
+			EmitByte(OP_POP);
+		}
+	}
+	for (u32 i = 0; i < operand_count - 1; i++) {
+		PatchJump(end_jumps[i]);
+	}
+	scanner = chain_end_scanner;
+	parser = chain_end_parser;
+	expression_is_int = false;
+}
+
+static void Or() {
+	i32 else_jump = EmitJump(OP_JUMP_IF_FALSE);
+	i32 end_jump = EmitJump(OP_JUMP);
+	PatchJump(else_jump);
+	EmitByte(OP_POP);
+	ParsePrecedence(PREC_OR);
+	PatchJump(end_jump);
+	expression_is_int = false;
+}
+
 static void Expression() {
 	ParsePrecedence(PREC_ASSIGNMNET);
 }
@@ -421,31 +999,32 @@ ParseRule rules[] = {
   [TOKEN_SEMICOLON]     = {NULL,     NULL,   PREC_NONE},
   [TOKEN_SLASH]         = {NULL,     Binary, PREC_FACTOR},
   [TOKEN_STAR]          = {NULL,     Binary, PREC_FACTOR},
-  [TOKEN_BANG]          = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_BANG_EQUAL]    = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_BANG]          = {Unary,    NULL,   PREC_NONE},
+  [TOKEN_BANG_EQUAL]    = {NULL,     Binary, PREC_EQUALITY},
   [TOKEN_EQUAL]         = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_EQUAL_EQUAL]   = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_GREATER]       = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_GREATER_EQUAL] = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_LESS]          = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_LESS_EQUAL]    = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_IDENTIFIER]    = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_STRING]        = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_EQUAL_EQUAL]   = {NULL,     Binary, PREC_EQUALITY},
+  [TOKEN_GREATER]       = {NULL,     Binary, PREC_COMPARISON},
+  [TOKEN_GREATER_EQUAL] = {NULL,     Binary, PREC_COMPARISON},
+  [TOKEN_LESS]          = {NULL,     Binary, PREC_COMPARISON},
+  [TOKEN_LESS_EQUAL]    = {NULL,     Binary, PREC_COMPARISON},
+  [TOKEN_IDENTIFIER]    = {Condition, NULL,   PREC_NONE},
+  [TOKEN_STRING]        = {ParserString, NULL, PREC_NONE},
   [TOKEN_NUMBER]        = {ParserNumber,   NULL,   PREC_NONE},
-  [TOKEN_AND]           = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_INTEGER]       = {ParserInteger,  NULL,   PREC_NONE},
+  [TOKEN_AND]           = {NULL,     And,    PREC_AND},
   //[TOKEN_CLASS]         = {NULL,     NULL,   PREC_NONE},
   [TOKEN_ELSE]          = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_FALSE]         = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_FALSE]         = {Literal,  NULL,   PREC_NONE},
   [TOKEN_FOR]           = {NULL,     NULL,   PREC_NONE},
   //[TOKEN_FUN] = {NULL,     NULL,   PREC_NONE},
   [TOKEN_IF]            = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_NIL]           = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_OR]            = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_NIL]           = {Literal,  NULL,   PREC_NONE},
+  [TOKEN_OR]            = {NULL,     Or,     PREC_OR},
   [TOKEN_PRINT]         = {NULL,     NULL,   PREC_NONE},
   [TOKEN_RETURN]        = {NULL,     NULL,   PREC_NONE},
   //[TOKEN_SUPER] = {NULL,     NULL,   PREC_NONE},
   //[TOKEN_THIS] = {NULL,     NULL,   PREC_NONE},
-  [TOKEN_TRUE]          = {NULL,     NULL,   PREC_NONE},
+  [TOKEN_TRUE]          = {Literal,  NULL,   PREC_NONE},
   //[TOKEN_VAR] = {NULL,     NULL,   PREC_NONE},
   [TOKEN_WHILE]         = {NULL,     NULL,   PREC_NONE},
   [TOKEN_RULE]          = {NULL,     NULL,   PREC_NONE},
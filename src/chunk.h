@@ -1,17 +1,22 @@
 #pragma once
+#include "condition_tables.h"
 
 enum ValueType {
 	VAL_BOOL,
 	VAL_NIL,
 	VAL_NUMBER,
-	VAL_STRING
+	VAL_STRING,
+	VAL_INT
 };
 
+//NOTE: strings are (pointer, length) and don't have to be NUL terminated, so they can point into source text
 struct Value {
 	ValueType type;
+	u32 length;
 	union {
 		b32 boolean;
 		f32 number;
+		i64 integer;
 		u8* string;
 	};
 };
@@ -22,32 +27,84 @@ struct ValueArray {
 	Value* values;
 };
 
+//NOTE: pass/fail counts for one operand of an "and" chain. Chains are keyed by their source offset
+//so a profile taken from one compile can be matched up when the same source is compiled again.
+struct ConditionProfile {
+	u32 chain;
+	u32 operand;
+	u32 cost;
+	u32 pass;
+	u32 fail;
+};
+
 struct Chunk {
 	i32 count;
 	i32 capacity;
 	u8* code;
 	i32* lines;
 	ValueArray constants;
+	ConditionProfile* profile;
+	i32 profile_count;
+	i32 profile_capacity;
+};
+
+struct ConditionRegistry;
+
+struct CompileOptions {
+	ConditionRegistry* registry; //resolves condition names to table slots
+	b8 profile_conditions;
+	Chunk* reorder_with; //a chunk compiled from the same source with profile_conditions on
+	b8 generate_domains; //literals compared to a condition are added to its domain instead of checked
 };
 
 enum OpCode {
 	OP_CONSTANT,
+	OP_NIL,
+	OP_TRUE,
+	OP_FALSE,
+	OP_POP,
+	OP_GET_CONDITION,
+	OP_EQUAL,
+	OP_GREATER,
+	OP_LESS,
 	OP_ADD,
 	OP_SUBTRACT,
 	OP_MULTIPLY,
 	OP_DIVIDE,
+	//NOTE: emitted when both operands are known to be ints at compile time, they skip the type checks
+	OP_EQUAL_INT,
+	OP_GREATER_INT,
+	OP_LESS_INT,
+	OP_ADD_INT,
+	OP_SUBTRACT_INT,
+	OP_MULTIPLY_INT,
+	OP_DIVIDE_INT,
+	OP_NOT,
 	OP_NEGATE,
+	OP_JUMP,
+	OP_JUMP_IF_FALSE,
+	OP_PROFILE,
 	OP_RETURN
 };
 
+struct ConditionTables;
+struct ConditionSnapshot;
+
 #define STACK_MAX 256
 struct VM {
 	Chunk* chunk;
+	ConditionTables* tables;
+	ConditionSnapshot* snapshot; //NOTE: when set conditions are read from it instead of tables
 	u8* ip;
 	Value stack[STACK_MAX];
 	Value* stack_top;
+	Value result; //NOTE: what the last OP_RETURN popped
+	b8 print_results;
 };
 
+Value QueryConditionValue(ConditionTables* tables, ConditionRef condition);
+Value QuerySnapshotValue(ConditionSnapshot* snapshot, ConditionRef condition);
+
 enum InterpretResult {
 	INTERPRET_OK,
 	INTERPRET_COMPILE_ERROR,
@@ -84,13 +141,21 @@ struct ParseRule {
 };
 
 #define DEFAULT_CHUNK_SIZE 1024
+#define DEFAULT_PROFILE_CAPACITY 256
+#define MAX_CHAIN_OPERANDS 32
 
 #define AsBool(value)    ((value).boolean)
 #define AsNumber(value)  ((value).number)
+#define AsInt(value)     ((value).integer)
 #define AsString(value)  ((value).string)
+#define AsStringLength(value) ((value).length)
+#define AsStringView(value) Str((value).string, (value).length)
 
 #define IsBool(value)    ((value).type == VAL_BOOL)
 #define IsNil(value)     ((value).type == VAL_NIL)
 #define IsNumber(value)  ((value).type == VAL_NUMBER)
 #define IsString(value)  ((value).type == VAL_STRING)
+#define IsInt(value)     ((value).type == VAL_INT)
+#define IsNumeric(value) (IsNumber(value) || IsInt(value))
+#define AsNumeric(value) (IsInt(value) ? (f64)AsInt(value) : (f64)AsNumber(value))
 
@@ -0,0 +1,129 @@
+#include "condition_index.h"
+
+void FloatIndexInit(FloatIndex* index, MemoryArena* arena, u32 capacity) {
+	index->entries = PushArray(arena, capacity, FloatIndexEntry);
+	index->positions = PushArray(arena, capacity, u32);
+	index->count = 0;
+	index->capacity = capacity;
+}
+
+//NOTE: moves the entry at position towards where value belongs, shifting the entries it passes over
+static void FloatIndexPlace(FloatIndex* index, u32 position, u32 id, f32 value) {
+	FloatIndexEntry* entries = index->entries;
+	while (position + 1 < index->count && entries[position + 1].value < value) {
+		entries[position] = entries[position + 1];
+		index->positions[entries[position].id] = position;
+		position++;
+	}
+	while (position > 0 && entries[position - 1].value > value) {
+		entries[position] = entries[position - 1];
+		index->positions[entries[position].id] = position;
+		position--;
+	}
+	entries[position] = {value, id};
+	index->positions[id] = position;
+}
+
+void FloatIndexInsert(FloatIndex* index, u32 id, f32 value) {
+	DASSERT(id < index->capacity);
+	DASSERT(index->count < index->capacity);
+	u32 position = index->count++;
+	FloatIndexPlace(index, position, id, value);
+}
+
+//NOTE: cost is the distance the value moves in sort order, small changes stay cheap
+void FloatIndexUpdate(FloatIndex* index, u32 id, f32 value) {
+	DASSERT(id < index->capacity);
+	FloatIndexPlace(index, index->positions[id], id, value);
+}
+
+//NOTE: writes up to max_ids ids with min <= value <= max in value order, returns how many were written
+u32 FloatIndexRange(FloatIndex* index, f32 min, f32 max, u32* ids, u32 max_ids) {
+	u32 low = 0;
+	u32 high = index->count;
+	while (low < high) {
+		u32 middle = low + (high - low) / 2;
+		if (index->entries[middle].value < min) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	u32 found = 0;
+	for (u32 i = low; i < index->count && index->entries[i].value <= max && found < max_ids; i++) {
+		ids[found++] = index->entries[i].id;
+	}
+	return found;
+}
+
+void ValueIndexInit(ValueIndex* index, MemoryArena* arena, u32 capacity, u32 bucket_count) {
+	bucket_count = RoundUpPowOf2(bucket_count);
+	index->heads = PushArray(arena, bucket_count, u32);
+	index->bucket_mask = bucket_count - 1;
+	index->keys = PushArray(arena, capacity, u32);
+	index->next = PushArray(arena, capacity, u32);
+	index->prev = PushArray(arena, capacity, u32);
+	index->count = 0;
+	index->capacity = capacity;
+	for (u32 i = 0; i < bucket_count; i++) {
+		index->heads[i] = INVALID_ID;
+	}
+}
+
+static void ValueIndexLink(ValueIndex* index, u32 id, u32 key) {
+	u32* head = index->heads + (key & index->bucket_mask);
+	index->keys[id] = key;
+	index->prev[id] = INVALID_ID;
+	index->next[id] = *head;
+	if (*head != INVALID_ID) {
+		index->prev[*head] = id;
+	}
+	*head = id;
+}
+
+static void ValueIndexUnlink(ValueIndex* index, u32 id) {
+	u32 next = index->next[id];
+	u32 prev = index->prev[id];
+	if (prev != INVALID_ID) {
+		index->next[prev] = next;
+	} else {
+		index->heads[index->keys[id] & index->bucket_mask] = next;
+	}
+	if (next != INVALID_ID) {
+		index->prev[next] = prev;
+	}
+}
+
+void ValueIndexInsert(ValueIndex* index, u32 id, u32 key) {
+	DASSERT(id < index->capacity);
+	index->count++;
+	ValueIndexLink(index, id, key);
+}
+
+void ValueIndexUpdate(ValueIndex* index, u32 id, u32 key) {
+	DASSERT(id < index->capacity);
+	if (index->keys[id] == key) {
+		return;
+	}
+	ValueIndexUnlink(index, id);
+	ValueIndexLink(index, id, key);
+}
+
+//NOTE: walks the key's bucket skipping ids that only share the bucket, returns INVALID_ID at the end.
+//String keys are hashes so callers still compare the strings themselves.
+u32 ValueIndexFirst(ValueIndex* index, u32 key) {
+	u32 id = index->heads[key & index->bucket_mask];
+	while (id != INVALID_ID && index->keys[id] != key) {
+		id = index->next[id];
+	}
+	return id;
+}
+
+u32 ValueIndexNext(ValueIndex* index, u32 id) {
+	u32 key = index->keys[id];
+	id = index->next[id];
+	while (id != INVALID_ID && index->keys[id] != key) {
+		id = index->next[id];
+	}
+	return id;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+struct FloatIndexEntry {
+	f32 value;
+	u32 id;
+};
+
+//NOTE: float conditions kept sorted by value, positions maps a condition id to where it sits in entries
+struct FloatIndex {
+	FloatIndexEntry* entries;
+	u32* positions;
+	u32 count;
+	u32 capacity;
+};
+
+//NOTE: conditions chained by key, one doubly linked list per bucket so a changed value can be
+//unlinked without a search. Chars use the char as the key, strings use the string's hash.
+struct ValueIndex {
+	u32* heads;
+	u32 bucket_mask;
+	u32* keys;
+	u32* next;
+	u32* prev;
+	u32 count;
+	u32 capacity;
+};
+
+void FloatIndexInit(FloatIndex* index, MemoryArena* arena, u32 capacity);
+void FloatIndexInsert(FloatIndex* index, u32 id, f32 value);
+void FloatIndexUpdate(FloatIndex* index, u32 id, f32 value);
+u32 FloatIndexRange(FloatIndex* index, f32 min, f32 max, u32* ids, u32 max_ids);
+
+void ValueIndexInit(ValueIndex* index, MemoryArena* arena, u32 capacity, u32 bucket_count);
+void ValueIndexInsert(ValueIndex* index, u32 id, u32 key);
+void ValueIndexUpdate(ValueIndex* index, u32 id, u32 key);
+u32 ValueIndexFirst(ValueIndex* index, u32 key);
+u32 ValueIndexNext(ValueIndex* index, u32 id);
@@ -0,0 +1,302 @@
+#include "condition_registry.h"
+
+void ConditionRegistryInit(ConditionRegistry* registry, MemoryArena* memory, u32 max_conditions) {
+	registry->memory = memory;
+	registry->entries = PushArray(memory, max_conditions, ConditionEntry);
+	registry->entry_count = 0;
+	registry->entry_capacity = max_conditions;
+	registry->lookup_capacity = RoundUpPowOf2(max_conditions * 2);
+	registry->lookup = PushArray(memory, registry->lookup_capacity, u32);
+	for (u32 i = 0; i < registry->lookup_capacity; i++) {
+		registry->lookup[i] = INVALID_ID;
+	}
+	for (u32 i = 0; i < CONDITION_TABLE_COUNT; i++) {
+		registry->next_slot[i] = 0;
+	}
+}
+
+//NOTE: name doesn't need to be NUL terminated, the compiler looks up straight from token text
+ConditionEntry* FindCondition(ConditionRegistry* registry, String name) {
+	u32 hash = StringHash(name);
+	u32 mask = registry->lookup_capacity - 1;
+	for (u32 slot = hash & mask; registry->lookup[slot] != INVALID_ID; slot = (slot + 1) & mask) {
+		ConditionEntry* entry = registry->entries + registry->lookup[slot];
+		if (entry->hash == hash && StringsEqual(entry->name, name)) {
+			return entry;
+		}
+	}
+	return 0;
+}
+
+//NOTE: slot ids are handed out per table in the order conditions are added, matching the order
+//ConditionRegistryCreateConditions adds them to the tables. The name is not copied.
+ConditionEntry* RegisterCondition(ConditionRegistry* registry, String name, ConditionTableType type, u32 value_capacity = DEFAULT_DOMAIN_CAPACITY) {
+	DASSERT(!FindCondition(registry, name));
+	DASSERT(registry->entry_count < registry->entry_capacity);
+	u32 index = registry->entry_count++;
+	ConditionEntry* entry = registry->entries + index;
+	entry->name = name;
+	entry->hash = StringHash(name);
+	entry->ref = {type, registry->next_slot[type]++};
+	entry->value_capacity = Maximum(value_capacity, 1u);
+	entry->values = PushArray(registry->memory, entry->value_capacity, Value);
+	entry->value_count = 0;
+
+	u32 mask = registry->lookup_capacity - 1;
+	u32 slot = entry->hash & mask;
+	while (registry->lookup[slot] != INVALID_ID) {
+		slot = (slot + 1) & mask;
+	}
+	registry->lookup[slot] = index;
+	return entry;
+}
+
+void AddDomainValue(ConditionRegistry* registry, ConditionEntry* entry, Value value) {
+	if (entry->value_count == entry->value_capacity) {
+		Value* values = PushArray(registry->memory, entry->value_capacity * 2, Value);
+		MemCopy(entry->values, values, entry->value_count * sizeof(Value));
+		entry->values = values;
+		entry->value_capacity *= 2;
+	}
+	entry->values[entry->value_count++] = value;
+}
+
+i32 FindDomainValue(ConditionEntry* entry, Value value) {
+	for (u32 i = 0; i < entry->value_count; i++) {
+		if (ValuesEqual(entry->values[i], value)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+//NOTE: values found while compiling point into script source, so strings get their own copy here
+void AddDomainValueIfNew(ConditionRegistry* registry, ConditionEntry* entry, Value value) {
+	if (FindDomainValue(entry, value) >= 0) {
+		return;
+	}
+	if (IsString(value)) {
+		u8* copy = PushCopy(registry->memory, AsString(value), AsStringLength(value), u8);
+		value = StringValN(copy, AsStringLength(value));
+	}
+	AddDomainValue(registry, entry, value);
+}
+
+//NOTE: values that don't fit the table's type don't count, so they end up in a wider table
+static b8 IsNumberText(String text) {
+	f32 value;
+	return ParseF32(text.data, text.length, &value) == PARSE_NUMBER_OK;
+}
+
+static b8 IsIntegerText(String text) {
+	i64 value;
+	return ParseI64(text.data, text.length, &value) == PARSE_NUMBER_OK;
+}
+
+static b8 IsBoolText(String text) {
+	return StringsEqual(text, StringLiteral("true")) || StringsEqual(text, StringLiteral("false"));
+}
+
+//NOTE: a condition's table comes from its values: all true/false is bool, all whole numbers is int, all numbers is float,
+//all single characters is char, anything else is a string. Built up one value at a time.
+struct ConditionTypeGuess {
+	b8 all_bool;
+	b8 all_integer;
+	b8 all_number;
+	b8 all_char;
+};
+
+static void GuessConditionType(ConditionTypeGuess* guess, String text) {
+	guess->all_bool = guess->all_bool && IsBoolText(text);
+	guess->all_integer = guess->all_integer && IsIntegerText(text);
+	guess->all_number = guess->all_number && IsNumberText(text);
+	guess->all_char = guess->all_char && text.length == 1;
+}
+
+static ConditionTableType GuessedConditionType(ConditionTypeGuess* guess, u32 value_count) {
+	if (value_count == 0) return CONDITION_TABLE_STRING;
+	if (guess->all_bool) return CONDITION_TABLE_BOOL;
+	if (guess->all_integer) return CONDITION_TABLE_INT;
+	if (guess->all_number) return CONDITION_TABLE_FLOAT;
+	if (guess->all_char) return CONDITION_TABLE_CHAR;
+	return CONDITION_TABLE_STRING;
+}
+
+//NOTE: string values stay views into text
+Value MakeDomainValue(ConditionTableType type, String text) {
+	switch (type) {
+		case CONDITION_TABLE_BOOL: return BoolVal(text.length == 4);
+		case CONDITION_TABLE_CHAR: return IntVal(text.data[0]);
+		case CONDITION_TABLE_INT: {
+			i64 value;
+			if (ParseI64(text.data, text.length, &value) != PARSE_NUMBER_OK) {
+				DWARN("%.*s isn't a 64 bit integer", text.length, text.data);
+			}
+			return IntVal(value);
+		}
+		case CONDITION_TABLE_FLOAT: {
+			f32 value;
+			if (ParseF32(text.data, text.length, &value) != PARSE_NUMBER_OK) {
+				DWARN("%.*s isn't a float", text.length, text.data);
+			}
+			return NumberVal(value);
+		}
+		default: return StringVal(text);
+	}
+}
+
+//NOTE: line is trimmed of surrounding white space, returns how far to move past it and its line ending
+static u32 NextLine(u8* at, u8* end, String* line) {
+	u8* start = at;
+	while (at < end && !IsEndOfLine(*at)) {
+		at++;
+	}
+	u8* line_start = start;
+	u8* line_end = at;
+	while (at < end && IsEndOfLine(*at)) {
+		at++;
+	}
+	while (line_start < line_end && IsWhiteSpace(*line_start)) {
+		line_start++;
+	}
+	while (line_end > line_start && IsWhiteSpace(*(line_end - 1))) {
+		line_end--;
+	}
+	*line = Str(line_start, (u32)(line_end - line_start));
+	return (u32)(at - start);
+}
+
+//NOTE: format is the condition name on its own line, then START, one value per line, then END.
+//Nothing is copied, names and string values are views into contents so it has to outlive the registry.
+//Each block is walked twice, once to size and type the domain and once to fill it, while it is still in cache.
+b32 LoadConditions(ConditionRegistry* registry, u8* contents, u64 contents_size) {
+	u8* at = contents;
+	u8* end = contents + contents_size;
+	while (at < end) {
+		String name;
+		at += NextLine(at, end, &name);
+		if (name.length == 0) {
+			continue;
+		}
+		String line;
+		at += NextLine(at, end, &line);
+		if (!StringsEqual(line, StringLiteral("START"))) {
+			DERROR("LoadConditions - expected START after '%.*s'", name.length, name.data);
+			return false;
+		}
+
+		u8* values_start = at;
+		u32 value_count = 0;
+		u32 longest_value = 0;
+		ConditionTypeGuess guess = {true, true, true, true};
+		for (;;) {
+			if (at >= end) {
+				DERROR("LoadConditions - missing END for '%.*s'", name.length, name.data);
+				return false;
+			}
+			at += NextLine(at, end, &line);
+			if (StringsEqual(line, StringLiteral("END"))) {
+				break;
+			}
+			if (line.length > 0) {
+				GuessConditionType(&guess, line);
+				value_count++;
+				longest_value = Maximum(longest_value, line.length);
+			}
+		}
+		if (FindCondition(registry, name)) {
+			DERROR("LoadConditions - '%.*s' is defined twice", name.length, name.data);
+			return false;
+		}
+
+		ConditionTableType type = GuessedConditionType(&guess, value_count);
+		if (type == CONDITION_TABLE_STRING && longest_value > STRING_MAX_LENGTH) {
+			DERROR("LoadConditions - '%.*s' has a value longer than %d bytes", name.length, name.data, STRING_MAX_LENGTH);
+			return false;
+		}
+		ConditionEntry* entry = RegisterCondition(registry, name, type, value_count);
+		for (u8* value_at = values_start; entry->value_count < value_count;) {
+			value_at += NextLine(value_at, end, &line);
+			if (line.length > 0) {
+				entry->values[entry->value_count++] = MakeDomainValue(type, line);
+			}
+		}
+	}
+	return true;
+}
+
+//NOTE: the file stays mapped for as long as the registry is used
+b32 LoadConditionsFile(ConditionRegistry* registry, char* filename) {
+	if (!PlatformMapFileReadOnly(filename, &registry->source)) {
+		DERROR("LoadConditionsFile - could not map %s", filename);
+		return false;
+	}
+	return LoadConditions(registry, registry->source.memory, registry->source.size);
+}
+
+//NOTE: adds every registered condition to its table, starting at the first value of its domain
+void ConditionRegistryCreateConditions(ConditionRegistry* registry, ConditionTables* tables) {
+	for (u32 i = 0; i < registry->entry_count; i++) {
+		ConditionEntry* entry = registry->entries + i;
+		Value initial = entry->value_count > 0 ? entry->values[0] : NilVal();
+		switch (entry->ref.table) {
+			case CONDITION_TABLE_BOOL:   tables->bool_table->AddCondition(IsBool(initial) && AsBool(initial)); break;
+			case CONDITION_TABLE_CHAR:   tables->char_table->AddCondition(IsInt(initial) ? (u8)AsInt(initial) : 0); break;
+			case CONDITION_TABLE_FLOAT:  tables->float_table->AddCondition(IsNumeric(initial) ? (f32)AsNumeric(initial) : 0.0f); break;
+			case CONDITION_TABLE_INT:    tables->int_table->AddCondition(IsInt(initial) ? AsInt(initial) : 0); break;
+			case CONDITION_TABLE_STRING: tables->string_table->AddCondition(IsString(initial) ? AsStringView(initial) : StringLiteral("")); break;
+			default: INVALID_CODE_PATH;
+		}
+	}
+}
+
+//NOTE: bytes each table needs for the registered conditions, for sizing tables that can't grow on their own
+void ConditionRegistryTableSizes(ConditionRegistry* registry, PersistentTableSizes* sizes) {
+	*sizes = {};
+	sizes->bools = registry->next_slot[CONDITION_TABLE_BOOL];
+	sizes->chars = registry->next_slot[CONDITION_TABLE_CHAR];
+	sizes->floats = registry->next_slot[CONDITION_TABLE_FLOAT] * sizeof(f32);
+	sizes->ints = registry->next_slot[CONDITION_TABLE_INT] * sizeof(i64);
+	sizes->string_look_aside = registry->next_slot[CONDITION_TABLE_STRING] * sizeof(i32);
+	for (u32 i = 0; i < registry->entry_count; i++) {
+		ConditionEntry* entry = registry->entries + i;
+		if (entry->ref.table == CONDITION_TABLE_STRING) {
+			u32 length = entry->value_count > 0 && IsString(entry->values[0]) ? AsStringLength(entry->values[0]) : 0;
+			sizes->strings += STRING_SLOT_HEADER + length + 1;
+		}
+	}
+}
+
+//NOTE: the name and table of every condition in registry order, which is the order they're created in
+u32 ConditionRegistryHash(ConditionRegistry* registry) {
+	u32 hash = HashBytes(&registry->entry_count, sizeof(registry->entry_count));
+	for (u32 i = 0; i < registry->entry_count; i++) {
+		ConditionEntry* entry = registry->entries + i;
+		hash = HashBytes(&entry->name.length, sizeof(entry->name.length), hash);
+		hash = HashBytes(entry->name.data, entry->name.length, hash);
+		hash = HashBytes(&entry->ref.table, sizeof(entry->ref.table), hash);
+	}
+	return hash;
+}
+
+//NOTE: creates the conditions in a mapped file's tables and records which ones they are in its header
+void ConditionRegistryCreatePersistentConditions(ConditionRegistry* registry, PersistentTables* persistent) {
+	ConditionRegistryCreateConditions(registry, persistent->tables);
+	persistent->header->conditions_hash = ConditionRegistryHash(registry);
+	persistent->header->condition_count = registry->entry_count;
+}
+
+//NOTE: true when the mapped tables hold exactly the conditions the registry would create, like after mapping
+//a file the same conditions file was loaded into before. Slot counts alone can't tell a renamed or reordered
+//condition apart, so the hash ConditionRegistryCreatePersistentConditions recorded has to match as well.
+b32 ConditionRegistryMatchesTables(ConditionRegistry* registry, PersistentTables* persistent) {
+	PersistentTablesHeader* header = persistent->header;
+	ConditionTables* tables = persistent->tables;
+	return header->condition_count == registry->entry_count &&
+		header->conditions_hash == ConditionRegistryHash(registry) &&
+		registry->next_slot[CONDITION_TABLE_BOOL] == tables->bool_table->memory.used &&
+		registry->next_slot[CONDITION_TABLE_CHAR] == tables->char_table->memory.used &&
+		registry->next_slot[CONDITION_TABLE_FLOAT] == tables->float_table->memory.used / sizeof(f32) &&
+		registry->next_slot[CONDITION_TABLE_INT] == tables->int_table->memory.used / sizeof(i64) &&
+		registry->next_slot[CONDITION_TABLE_STRING] == tables->string_table->look_aside_memory.used / sizeof(i32);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#define DEFAULT_DOMAIN_CAPACITY 8
+
+//NOTE: name is a view into the conditions file and isn't NUL terminated, values is the condition's domain
+struct ConditionEntry {
+	String name;
+	u32 hash;
+	ConditionRef ref;
+	Value* values;
+	u32 value_count;
+	u32 value_capacity;
+};
+
+struct ConditionRegistry {
+	MemoryArena* memory;
+	MappedFile source;
+
+	ConditionEntry* entries;
+	u32 entry_count;
+	u32 entry_capacity;
+
+	u32* lookup;
+	u32 lookup_capacity;
+
+	u32 next_slot[CONDITION_TABLE_COUNT];
+};
+
+ConditionEntry* FindCondition(ConditionRegistry* registry, String name);
+i32 FindDomainValue(ConditionEntry* entry, Value value);
+void AddDomainValueIfNew(ConditionRegistry* registry, ConditionEntry* entry, Value value);
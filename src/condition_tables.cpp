@@ -1,14 +1,75 @@
 #include "condition_tables.h"
 
+//NOTE: when set, the plain SetConditionValue calls report every write made on this thread. RuleMemo
+//uses it to learn what a rule does. Increments are reported as the amount added, not the result.
+#ifdef RULE_MEMO_ENABLED
+typedef void ConditionWriteHook(ConditionRef condition, Value value, b8 increment);
+static thread_local ConditionWriteHook* condition_write_hook;
+
+inline void ReportConditionWrite(ConditionRef condition, Value value, b8 increment) {
+	if (condition_write_hook) {
+		condition_write_hook(condition, value, increment);
+	}
+}
+#else
+inline void ReportConditionWrite(ConditionRef condition, Value value, b8 increment) {}
+#endif
+
+//NOTE: concurrent mode views the plain table memory through std::atomic, which has the same size
+//and layout as the underlying type for everything the tables store
+#define AtomicView(type, pointer) ((std::atomic<type>*)(pointer))
+static_assert(sizeof(std::atomic<u8>) == sizeof(u8) && sizeof(std::atomic<f32>) == sizeof(f32) &&
+	sizeof(std::atomic<i64>) == sizeof(i64) && sizeof(std::atomic<u64>) == sizeof(u64), "atomics must match the table layout");
+
+//NOTE: claims size bytes at the end of the table with a fetch-add on used. Everything below the arena's
+//committed is committed, a writer whose slot is past it commits the slot's pages itself before writing.
+//It only moves committed up over its pages when committed already reaches them, a writer that finishes
+//first on a later page leaves committed where it was so it never covers a page that isn't committed yet.
+//Committing a page twice is harmless so writers racing for the same page don't need a lock.
+static u64 ConcurrentAppend(MemoryArena* memory, u64 size) {
+	u64 offset = AtomicView(u64, &memory->used)->fetch_add(size, std::memory_order_relaxed);
+	u64 end = offset + size;
+	DASSERT(end <= memory->size);
+	std::atomic<u64>* committed_end = AtomicView(u64, &memory->committed);
+	u64 known = committed_end->load(std::memory_order_acquire);
+	if (end > known) {
+		u64 first_page = offset / PAGE_SIZE;
+		u64 last_page = (end - 1) / PAGE_SIZE;
+		CommitPage(memory->base + first_page * PAGE_SIZE, (u32)(last_page - first_page + 1));
+		AtomicView(u32, &memory->commit_count)->fetch_add(1, std::memory_order_relaxed);
+		u64 page_start = first_page * PAGE_SIZE;
+		u64 page_end = (last_page + 1) * PAGE_SIZE;
+		while (known >= page_start && known < page_end &&
+			!committed_end->compare_exchange_weak(known, page_end, std::memory_order_release, std::memory_order_acquire)) {
+		}
+	}
+	return offset;
+}
+
 //NOTE: leaving bool table and char table separate in case I want to turn the bool table into a bit array
 struct BoolTable {
 	MemoryArena memory;
+	ReteNetwork* network;
+	ConditionSnapshots* snapshots;
 
-	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1) {
-		i32 page_count = total_table_size / PAGE_SIZE;
-		ReservePage(base_address, page_count);
-		u8* table_memory = (u8*)CommitPage(base_address, pages_to_commit);
+	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1, u64 commit_step = TABLE_COMMIT_STEP) {
+		b32 reserved = InitializeGrowingArena(&memory, total_table_size, commit_step, (u64)pages_to_commit * PAGE_SIZE, base_address);
+		DASSERT(reserved);
+		ArenaRegister(&memory, "bool table");
+	}
+
+	//NOTE: for memory that is already committed and may already hold conditions, like a mapped file
+	void InitWithMemory(u8* table_memory, u64 total_table_size, u64 used) {
 		InitializeArena(&memory, total_table_size, table_memory);
+		ArenaRegister(&memory, "bool table");
+		memory.used = used;
+	}
+
+	//NOTE: for tables whose size is known up front, the whole table is committed now with page_flags
+	void InitCommitted(u8* base_address, u64 total_table_size, u32 page_flags) {
+		u8* table_memory = (u8*)ReserveAndCommitPages(base_address, total_table_size, page_flags);
+		DASSERT(table_memory);
+		InitWithMemory(table_memory, total_table_size, 0);
 	}
 	
 	b8 QueryCondition(BoolConditionId condition) {
@@ -20,30 +81,69 @@ struct BoolTable {
 	void SetConditionValue(BoolConditionId condition, b8 value) {
 		DASSERT(condition <= memory.used);
 		*(memory.base + condition) = value;
+		if (snapshots) {
+			SnapshotConditionSet(snapshots, {CONDITION_TABLE_BOOL, condition}, BoolVal(value));
+		}
+		if (network) {
+			ReteConditionChanged(network, {CONDITION_TABLE_BOOL, condition});
+		}
+		ReportConditionWrite({CONDITION_TABLE_BOOL, condition}, BoolVal(value), false);
 	}
 
 	BoolConditionId AddCondition(b8 initial_value) {
-		i32 current_page_count = memory.used / PAGE_SIZE;
-		i32 next_page_count = (memory.used+1) / PAGE_SIZE;
-		if (next_page_count > current_page_count) {
-			u8* alloc_addr = memory.base + memory.used;
-			CommitPage(alloc_addr, 1);
-		}
 		u8* index = PushSize(&memory, 1);
 		*index = initial_value;
 		i32 result = memory.used - 1;
+		if (snapshots) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_BOOL, (u32)result}, BoolVal(initial_value));
+		}
 		return (BoolConditionId)result;
 	}
+
+	//NOTE: concurrent mode, safe to call from any number of threads at once. Don't mix with the plain calls while other threads are writing.
+	b8 QueryConditionConcurrent(BoolConditionId condition) {
+		DASSERT(condition < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		return AtomicView(u8, memory.base + condition)->load(std::memory_order_acquire);
+	}
+
+	void SetConditionValueConcurrent(BoolConditionId condition, b8 value) {
+		DASSERT(!snapshots);
+		DASSERT(condition < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		AtomicView(u8, memory.base + condition)->store(value, std::memory_order_release);
+	}
+
+	BoolConditionId AddConditionConcurrent(b8 initial_value) {
+		DASSERT(!snapshots);
+		u64 offset = ConcurrentAppend(&memory, 1);
+		AtomicView(u8, memory.base + offset)->store(initial_value, std::memory_order_release);
+		return (BoolConditionId)offset;
+	}
 };
 
 struct CharTable {
 	MemoryArena memory;
+	ValueIndex* index;
+	ReteNetwork* network;
+	ConditionSnapshots* snapshots;
+
+	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1, u64 commit_step = TABLE_COMMIT_STEP) {
+		b32 reserved = InitializeGrowingArena(&memory, total_table_size, commit_step, (u64)pages_to_commit * PAGE_SIZE, base_address);
+		DASSERT(reserved);
+		ArenaRegister(&memory, "char table");
+	}
 
-	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1) {
-		i32 page_count = total_table_size / PAGE_SIZE;
-		ReservePage(base_address, page_count);
-		u8* table_memory = (u8*)CommitPage(base_address, pages_to_commit);
+	//NOTE: for memory that is already committed and may already hold conditions, like a mapped file
+	void InitWithMemory(u8* table_memory, u64 total_table_size, u64 used) {
 		InitializeArena(&memory, total_table_size, table_memory);
+		ArenaRegister(&memory, "char table");
+		memory.used = used;
+	}
+
+	//NOTE: for tables whose size is known up front, the whole table is committed now with page_flags
+	void InitCommitted(u8* base_address, u64 total_table_size, u32 page_flags) {
+		u8* table_memory = (u8*)ReserveAndCommitPages(base_address, total_table_size, page_flags);
+		DASSERT(table_memory);
+		InitWithMemory(table_memory, total_table_size, 0);
 	}
 	
 	u8 QueryCondition(CharConditionId condition) {
@@ -55,18 +155,66 @@ struct CharTable {
 	void SetConditionValue(CharConditionId condition, u8 value) {
 		DASSERT(condition <= memory.used);
 		*(memory.base + condition) = value;
+		if (index) {
+			ValueIndexUpdate(index, condition, value);
+		}
+		if (snapshots) {
+			SnapshotConditionSet(snapshots, {CONDITION_TABLE_CHAR, condition}, IntVal(value));
+		}
+		if (network) {
+			ReteConditionChanged(network, {CONDITION_TABLE_CHAR, condition});
+		}
+		ReportConditionWrite({CONDITION_TABLE_CHAR, condition}, IntVal(value), false);
+	}
+
+	//NOTE: indexes every condition already in the table, the index is kept current from then on
+	void AttachIndex(ValueIndex* value_index) {
+		index = value_index;
+		for (u32 condition = 0; condition < memory.used; condition++) {
+			ValueIndexInsert(index, condition, *(memory.base + condition));
+		}
+	}
+
+	u32 FindConditionsEqual(u8 value, CharConditionId* conditions, u32 max_conditions) {
+		DASSERT(index);
+		u32 found = 0;
+		for (u32 id = ValueIndexFirst(index, value); id != INVALID_ID && found < max_conditions; id = ValueIndexNext(index, id)) {
+			conditions[found++] = (CharConditionId)id;
+		}
+		return found;
 	}
 
 	CharConditionId AddCondition(u8 initial_value) {
-		i32 current_page_count = memory.used / PAGE_SIZE;
-		i32 next_page_count = (memory.used+1) / PAGE_SIZE;
-		if (next_page_count > current_page_count) {
-			u8* alloc_addr = memory.base + memory.used;
-			CommitPage(alloc_addr, 1);
+		u8* condition = PushSize(&memory, 1);
+		*condition = initial_value;
+		if (index) {
+			ValueIndexInsert(index, memory.used - 1, initial_value);
 		}
-		u8* index = PushSize(&memory, 1);
-		*index = initial_value;
-		return (CharConditionId)memory.used;
+		if (snapshots) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_CHAR, (u32)(memory.used - 1)}, IntVal(initial_value));
+		}
+		return (CharConditionId)(memory.used - 1);
+	}
+
+	//NOTE: concurrent mode doesn't maintain an attached index or snapshots
+	u8 QueryConditionConcurrent(CharConditionId condition) {
+		DASSERT(condition < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		return AtomicView(u8, memory.base + condition)->load(std::memory_order_acquire);
+	}
+
+	void SetConditionValueConcurrent(CharConditionId condition, u8 value) {
+		DASSERT(!snapshots);
+		DASSERT(!index);
+		DASSERT(condition < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		AtomicView(u8, memory.base + condition)->store(value, std::memory_order_release);
+	}
+
+	CharConditionId AddConditionConcurrent(u8 initial_value) {
+		DASSERT(!snapshots);
+		DASSERT(!index);
+		u64 offset = ConcurrentAppend(&memory, 1);
+		AtomicView(u8, memory.base + offset)->store(initial_value, std::memory_order_release);
+		return (CharConditionId)offset;
 	}
 
 };
@@ -74,6 +222,9 @@ struct CharTable {
 struct StringTable {
 	MemoryArena look_aside_memory;
 	MemoryArena conditions_memory;
+	ValueIndex* index;
+	ReteNetwork* network;
+	ConditionSnapshots* snapshots;
 
 	//NOTE: pages to commit DOES NOT INCLUDE THE LOOK_ASIDE PAGE
 	//Assuming look_aside_size is always 1 page for now
@@ -82,84 +233,163 @@ struct StringTable {
 		i32 look_aside_pages = look_aside_size / PAGE_SIZE;
 
 		u8* look_aside = (u8*)ReserveAndCommitPage(base_address, look_aside_pages);
+		DASSERT(look_aside);
 		InitializeArena(&look_aside_memory, look_aside_size, look_aside);
 		base_address = base_address + look_aside_size+1;
 
-		u8* conditions = (u8*)ReservePage(0, conditions_size/PAGE_SIZE);
-		conditions = (u8*)CommitPage(conditions, pages_to_commit);
+		b32 reserved = InitializeGrowingArena(&conditions_memory, conditions_size, TABLE_COMMIT_STEP, (u64)pages_to_commit * PAGE_SIZE);
+		DASSERT(reserved);
+		ArenaRegister(&look_aside_memory, "string look-aside");
+		ArenaRegister(&conditions_memory, "string table");
+	}
+
+	void InitWithMemory(u8* look_aside, u64 look_aside_size, u64 look_aside_used, u8* conditions, u64 conditions_size, u64 conditions_used) {
+		InitializeArena(&look_aside_memory, look_aside_size, look_aside);
+		look_aside_memory.used = look_aside_used;
 		InitializeArena(&conditions_memory, conditions_size, conditions);
+		conditions_memory.used = conditions_used;
+		ArenaRegister(&look_aside_memory, "string look-aside");
+		ArenaRegister(&conditions_memory, "string table");
 	}
 
+	//NOTE: NUL terminated inside its slot
 	u8* QueryCondition(StringConditionId condition) {
 		i32 condition_in_bytes = condition * sizeof(i32);
 		DASSERT(condition_in_bytes <= look_aside_memory.used);
-		i32 condition_offset = *(look_aside_memory.base + condition_in_bytes);
+		i32 condition_offset = *(i32*)(look_aside_memory.base + condition_in_bytes);
 		u8* result = conditions_memory.base + condition_offset;
 		return result;
 	}
+
+	String QueryConditionString(StringConditionId condition) {
+		u8* result = QueryCondition(condition);
+		return Str(result, *(result - 1));
+	}
 	
-	void SetConditionValue(StringConditionId condition, u8* value) {
+	void SetConditionValue(StringConditionId condition, String value) {
 		u32 condition_in_bytes = condition * sizeof(i32);
 		DASSERT(condition_in_bytes <= look_aside_memory.used);
-		u8 value_length = StringLength((u8*)value);
-		u32 condition_table_offset = *(look_aside_memory.base + condition_in_bytes);
+		DASSERT(value.length <= STRING_MAX_LENGTH);
+		u8 value_size = (u8)(value.length + 1);
+		u32 condition_table_offset = *(i32*)(look_aside_memory.base + condition_in_bytes);
 		u8* curr_condition = conditions_memory.base + condition_table_offset;
-		u8 slot_size = *(curr_condition-1);
+		u8 slot_size = *(curr_condition - STRING_SLOT_HEADER);
 		
-		if (value_length > slot_size) {
-			*(curr_condition - 1) = value_length;
+		if (value_size > slot_size) {
+			*(curr_condition - STRING_SLOT_HEADER) = value_size;
 			//shift all offsets by length diff
-			i32 length_diff = value_length - slot_size;
+			i32 length_diff = value_size - slot_size;
 		    i32* look_aside_ptr = (i32*)look_aside_memory.base;
 			i32 look_aside_used_slots = look_aside_memory.used / sizeof(i32);
 			for (i32 index = condition+1; index < look_aside_used_slots; index++) {
 				look_aside_ptr[index] = look_aside_ptr[index]+length_diff;
 			}
-			//if last offset is off the end of committed memory, commit another page
-			i32 curr_condition_page_count = conditions_memory.used / PAGE_SIZE;
-			i32 next_condition_page_count = (conditions_memory.used + length_diff) / PAGE_SIZE;
-			if (next_condition_page_count > curr_condition_page_count) {
-				u8* alloc_addr = conditions_memory.base + next_condition_page_count*PAGE_SIZE;
-				CommitPage(alloc_addr, 1);
-			}
-			u32 next_condition_table_offset = *(look_aside_memory.base + condition_in_bytes + sizeof(i32));
+			//NOTE: the next condition starts at its header, right after this slot
+			u64 used = conditions_memory.used;
+			PushSize(&conditions_memory, length_diff);
+			u32 next_condition_table_offset = condition_table_offset + slot_size;
 			u8* next_condition = conditions_memory.base + next_condition_table_offset;
-			MemMove(next_condition+length_diff, next_condition, conditions_memory.used-next_condition_table_offset);
+			if (next_condition_table_offset < used) {
+				MemMove(next_condition, next_condition+length_diff, used-next_condition_table_offset);
+			}
+		}
+		*(curr_condition - 1) = (u8)value.length;
+		MemCopy(value.data, curr_condition, value.length);
+		curr_condition[value.length] = '\0';
+		if (index) {
+			ValueIndexUpdate(index, condition, StringHash(value));
+		}
+		if (snapshots) {
+			SnapshotConditionSet(snapshots, {CONDITION_TABLE_STRING, condition}, StringVal(value));
 		}
-		StringCopy(value, curr_condition);
+		if (network) {
+			ReteConditionChanged(network, {CONDITION_TABLE_STRING, condition});
+		}
+		ReportConditionWrite({CONDITION_TABLE_STRING, condition}, StringVal(value), false);
+	}
+
+	void SetConditionValue(StringConditionId condition, u8* value) {
+		SetConditionValue(condition, StringFromC(value));
 	}
 
+	void AttachIndex(ValueIndex* value_index) {
+		index = value_index;
+		u32 condition_count = look_aside_memory.used / sizeof(i32);
+		for (u32 condition = 0; condition < condition_count; condition++) {
+			ValueIndexInsert(index, condition, StringHash(QueryConditionString((StringConditionId)condition)));
+		}
+	}
 
-	//NOTE: there is a size header for each string as the first byte before the start of the string, that's why all the +1s are there
-	StringConditionId AddCondition(u8* initial_value) {
-		u8 value_length = StringLength(initial_value);
+	u32 FindConditionsEqual(String value, StringConditionId* conditions, u32 max_conditions) {
+		DASSERT(index);
+		u32 found = 0;
+		u32 key = StringHash(value);
+		for (u32 id = ValueIndexFirst(index, key); id != INVALID_ID && found < max_conditions; id = ValueIndexNext(index, id)) {
+			if (StringsEqual(QueryConditionString((StringConditionId)id), value)) {
+				conditions[found++] = (StringConditionId)id;
+			}
+		}
+		return found;
+	}
+
+	u32 FindConditionsEqual(u8* value, StringConditionId* conditions, u32 max_conditions) {
+		return FindConditionsEqual(StringFromC(value), conditions, max_conditions);
+	}
+
+	//NOTE: each string has a two byte header before it, the slot size (which counts the terminator)
+	//and then the string's length
+	StringConditionId AddCondition(String initial_value) {
+		DASSERT(initial_value.length <= STRING_MAX_LENGTH);
+		u8 value_size = (u8)(initial_value.length + 1);
 		i32* new_look_aside = PushType(&look_aside_memory, i32);
-		i32 curr_condition_page_count = conditions_memory.used / PAGE_SIZE;
-		i32 next_condition_page_count = (conditions_memory.used + value_length) / PAGE_SIZE;
-		if (next_condition_page_count > curr_condition_page_count) {
-			u8* alloc_addr = conditions_memory.base + next_condition_page_count*PAGE_SIZE;
-			CommitPage(alloc_addr, 1);
+		*new_look_aside = conditions_memory.used + STRING_SLOT_HEADER;
+		u8* new_condition = PushSize(&conditions_memory, STRING_SLOT_HEADER + value_size);
+		new_condition[0] = value_size;
+		new_condition[1] = (u8)initial_value.length;
+		MemCopy(initial_value.data, new_condition + STRING_SLOT_HEADER, initial_value.length);
+		new_condition[STRING_SLOT_HEADER + initial_value.length] = '\0';
+		if (index) {
+			ValueIndexInsert(index, look_aside_memory.used / sizeof(i32) - 1, StringHash(initial_value));
+		}
+		if (snapshots) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_STRING, (u32)(look_aside_memory.used / sizeof(i32) - 1)}, StringVal(initial_value));
 		}
-		*new_look_aside = conditions_memory.used+1;
-		u8* new_condition = PushSize(&conditions_memory, value_length+1);
-		*new_condition = value_length;
-		StringCopy(initial_value, new_condition+1, value_length);
-		return (StringConditionId)*new_look_aside;
+		return (StringConditionId)(look_aside_memory.used / sizeof(i32) - 1);
+	}
+
+	StringConditionId AddCondition(u8* initial_value) {
+		return AddCondition(StringFromC(initial_value));
 	}
 
 	StringConditionId AddCondition(char* initial_value) {
-		return AddCondition((u8*)initial_value);
+		return AddCondition(StringFromC(initial_value));
 	}
 };
 
 struct FloatTable {
 	MemoryArena memory;
+	FloatIndex* index;
+	ReteNetwork* network;
+	ConditionSnapshots* snapshots;
 	
-	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1) {
-		i32 page_count = total_table_size / PAGE_SIZE;
-		ReservePage(base_address, page_count);
-		u8* table_memory = (u8*)CommitPage(base_address, pages_to_commit);
+	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1, u64 commit_step = TABLE_COMMIT_STEP) {
+		b32 reserved = InitializeGrowingArena(&memory, total_table_size, commit_step, (u64)pages_to_commit * PAGE_SIZE, base_address);
+		DASSERT(reserved);
+		ArenaRegister(&memory, "float table");
+	}
+
+	//NOTE: for memory that is already committed and may already hold conditions, like a mapped file
+	void InitWithMemory(u8* table_memory, u64 total_table_size, u64 used) {
 		InitializeArena(&memory, total_table_size, table_memory);
+		ArenaRegister(&memory, "float table");
+		memory.used = used;
+	}
+
+	//NOTE: for tables whose size is known up front, the whole table is committed now with page_flags
+	void InitCommitted(u8* base_address, u64 total_table_size, u32 page_flags) {
+		u8* table_memory = (u8*)ReserveAndCommitPages(base_address, total_table_size, page_flags);
+		DASSERT(table_memory);
+		InitWithMemory(table_memory, total_table_size, 0);
 	}
 
 	f32 QueryCondition(FloatConditionId condition) {
@@ -173,50 +403,338 @@ struct FloatTable {
 		DASSERT(condition*sizeof(f32) <= memory.used);
 		f32* base_ptr = (f32*)memory.base;
 		*(base_ptr+condition) = value;
+		if (index) {
+			FloatIndexUpdate(index, condition, value);
+		}
+		if (snapshots) {
+			SnapshotConditionSet(snapshots, {CONDITION_TABLE_FLOAT, condition}, NumberVal(value));
+		}
+		if (network) {
+			ReteConditionChanged(network, {CONDITION_TABLE_FLOAT, condition});
+		}
+		ReportConditionWrite({CONDITION_TABLE_FLOAT, condition}, NumberVal(value), false);
 	}
 
-	FloatConditionId AddCondition(f32 initial_value) {
-		i32 curr_page_count = memory.used / PAGE_SIZE;
-		i32 next_page_count = (memory.used+sizeof(f32)) / PAGE_SIZE;
-		if (next_page_count > curr_page_count) {
-			u8* page_alloc_addr = memory.base + next_page_count*PAGE_SIZE;
-			CommitPage(page_alloc_addr, 1);
+	void AttachIndex(FloatIndex* float_index) {
+		index = float_index;
+		u32 condition_count = memory.used / sizeof(f32);
+		for (u32 condition = 0; condition < condition_count; condition++) {
+			FloatIndexInsert(index, condition, QueryCondition((FloatConditionId)condition));
 		}
+	}
+
+	//NOTE: min <= value <= max, in value order
+	u32 FindConditionsInRange(f32 min, f32 max, FloatConditionId* conditions, u32 max_conditions) {
+		DASSERT(index);
+		return FloatIndexRange(index, min, max, (u32*)conditions, max_conditions);
+	}
+
+	FloatConditionId AddCondition(f32 initial_value) {
 		f32* new_condition = PushType(&memory, f32);
 		*new_condition = initial_value;
-		return (FloatConditionId)(memory.used / sizeof(f32));
+		if (index) {
+			FloatIndexInsert(index, memory.used / sizeof(f32) - 1, initial_value);
+		}
+		if (snapshots) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_FLOAT, (u32)(memory.used / sizeof(f32) - 1)}, NumberVal(initial_value));
+		}
+		return (FloatConditionId)(memory.used / sizeof(f32) - 1);
+	}
+
+	//NOTE: concurrent mode doesn't maintain an attached index or snapshots
+	f32 QueryConditionConcurrent(FloatConditionId condition) {
+		DASSERT(condition*sizeof(f32) < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		return AtomicView(f32, (f32*)memory.base + condition)->load(std::memory_order_acquire);
+	}
+
+	void SetConditionValueConcurrent(FloatConditionId condition, f32 value) {
+		DASSERT(!snapshots);
+		DASSERT(!index);
+		DASSERT(condition*sizeof(f32) < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		AtomicView(f32, (f32*)memory.base + condition)->store(value, std::memory_order_release);
+	}
+
+	FloatConditionId AddConditionConcurrent(f32 initial_value) {
+		DASSERT(!snapshots);
+		DASSERT(!index);
+		u64 offset = ConcurrentAppend(&memory, sizeof(f32));
+		AtomicView(f32, memory.base + offset)->store(initial_value, std::memory_order_release);
+		return (FloatConditionId)(offset / sizeof(f32));
+	}
+};
+
+//NOTE: counters and ids that need more than a float's 24 bits of precision
+struct IntTable {
+	MemoryArena memory;
+	ReteNetwork* network;
+	ConditionSnapshots* snapshots;
+
+	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1, u64 commit_step = TABLE_COMMIT_STEP) {
+		b32 reserved = InitializeGrowingArena(&memory, total_table_size, commit_step, (u64)pages_to_commit * PAGE_SIZE, base_address);
+		DASSERT(reserved);
+		ArenaRegister(&memory, "int table");
+	}
+
+	//NOTE: for memory that is already committed and may already hold conditions, like a mapped file
+	void InitWithMemory(u8* table_memory, u64 total_table_size, u64 used) {
+		InitializeArena(&memory, total_table_size, table_memory);
+		ArenaRegister(&memory, "int table");
+		memory.used = used;
+	}
+
+	//NOTE: for tables whose size is known up front, the whole table is committed now with page_flags
+	void InitCommitted(u8* base_address, u64 total_table_size, u32 page_flags) {
+		u8* table_memory = (u8*)ReserveAndCommitPages(base_address, total_table_size, page_flags);
+		DASSERT(table_memory);
+		InitWithMemory(table_memory, total_table_size, 0);
+	}
+
+	i64 QueryCondition(IntConditionId condition) {
+		DASSERT(condition*sizeof(i64) < memory.used);
+		i64* base_ptr = (i64*)memory.base;
+		return *(base_ptr+condition);
+	}
+
+	void SetConditionValue(IntConditionId condition, i64 value) {
+		DASSERT(condition*sizeof(i64) < memory.used);
+		i64* base_ptr = (i64*)memory.base;
+		*(base_ptr+condition) = value;
+		if (snapshots) {
+			SnapshotConditionSet(snapshots, {CONDITION_TABLE_INT, condition}, IntVal(value));
+		}
+		if (network) {
+			ReteConditionChanged(network, {CONDITION_TABLE_INT, condition});
+		}
+		ReportConditionWrite({CONDITION_TABLE_INT, condition}, IntVal(value), false);
+	}
+
+	void IncrementCondition(IntConditionId condition, i64 amount = 1) {
+		DASSERT(condition*sizeof(i64) < memory.used);
+		i64* base_ptr = (i64*)memory.base;
+		*(base_ptr+condition) += amount;
+		if (snapshots) {
+			SnapshotConditionSet(snapshots, {CONDITION_TABLE_INT, condition}, IntVal(*(base_ptr+condition)));
+		}
+		if (network) {
+			ReteConditionChanged(network, {CONDITION_TABLE_INT, condition});
+		}
+		ReportConditionWrite({CONDITION_TABLE_INT, condition}, IntVal(amount), true);
+	}
+
+	IntConditionId AddCondition(i64 initial_value) {
+		i64* new_condition = PushType(&memory, i64);
+		*new_condition = initial_value;
+		if (snapshots) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_INT, (u32)(memory.used / sizeof(i64) - 1)}, IntVal(initial_value));
+		}
+		return (IntConditionId)(memory.used / sizeof(i64) - 1);
+	}
+
+	i64 QueryConditionConcurrent(IntConditionId condition) {
+		DASSERT(condition*sizeof(i64) < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		return AtomicView(i64, (i64*)memory.base + condition)->load(std::memory_order_acquire);
+	}
+
+	void SetConditionValueConcurrent(IntConditionId condition, i64 value) {
+		DASSERT(!snapshots);
+		DASSERT(condition*sizeof(i64) < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		AtomicView(i64, (i64*)memory.base + condition)->store(value, std::memory_order_release);
+	}
+
+	//NOTE: a fetch-add, so counters bumped from several threads don't lose updates
+	i64 IncrementConditionConcurrent(IntConditionId condition, i64 amount = 1) {
+		DASSERT(!snapshots);
+		DASSERT(condition*sizeof(i64) < AtomicView(u64, &memory.used)->load(std::memory_order_relaxed));
+		return AtomicView(i64, (i64*)memory.base + condition)->fetch_add(amount, std::memory_order_acq_rel) + amount;
+	}
+
+	IntConditionId AddConditionConcurrent(i64 initial_value) {
+		DASSERT(!snapshots);
+		u64 offset = ConcurrentAppend(&memory, sizeof(i64));
+		AtomicView(i64, memory.base + offset)->store(initial_value, std::memory_order_release);
+		return (IntConditionId)(offset / sizeof(i64));
 	}
 };
 
 typedef void RuleFunc(void);
 
+#define RULE_PREFETCH_DISTANCE 8
+
+//NOTE: two pass radix sort so a batch reads its func slots front to back. Meant to run once when a batch
+//is built, not every run, and only for batches whose rules don't depend on each other's order.
+void SortRulesForLocality(RuleId* rules, u32 count, RuleId* scratch) {
+	TempMemory temp = GetScratch();
+	u32* counts = PushArray(temp.arena, 1 << 16, u32);
+	RuleId* from = rules;
+	RuleId* to = scratch;
+	for (u32 shift = 0; shift < 32; shift += 16) {
+		memset(counts, 0, (1 << 16) * sizeof(u32));
+		for (u32 i = 0; i < count; i++) {
+			counts[((u32)from[i] >> shift) & 0xFFFF]++;
+		}
+		u32 start = 0;
+		for (u32 digit = 0; digit < (1 << 16); digit++) {
+			u32 digit_count = counts[digit];
+			counts[digit] = start;
+			start += digit_count;
+		}
+		for (u32 i = 0; i < count; i++) {
+			to[counts[((u32)from[i] >> shift) & 0xFFFF]++] = from[i];
+		}
+		RuleId* swap = from;
+		from = to;
+		to = swap;
+	}
+	ReleaseScratch(temp);
+}
+
 struct RuleTable {
 	MemoryArena memory;
+	//NOTE: the rule being run, lets one func serve many rules that each keep their own data. Per thread
+	//since several threads run rules from the same table.
+	static thread_local RuleId current_rule;
+	RuleInputs* inputs;
+	ConditionTables* input_tables;
 
-	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1) {
-		i32 page_count = total_table_size / PAGE_SIZE;
-		void* table_memory = ReservePage(base_address, page_count);
-		CommitPage(table_memory, pages_to_commit);
-		InitializeArena(&memory, total_table_size, (u8*)table_memory);
+	void Init(u8* base_address, i32 total_table_size, i32 pages_to_commit = 1, u64 commit_step = TABLE_COMMIT_STEP) {
+		b32 reserved = InitializeGrowingArena(&memory, total_table_size, commit_step, (u64)pages_to_commit * PAGE_SIZE, base_address);
+		DASSERT(reserved);
+		ArenaRegister(&memory, "rule table");
 	}
 
 	void RunRule(RuleId rule) {
 		u32 rule_in_bytes = rule * sizeof(void*);
 		DASSERT(rule_in_bytes <= memory.used);
 		RuleFunc* func = *((RuleFunc**)(memory.base + rule_in_bytes));
+		current_rule = rule;
 		func();
 	}
 
-	RuleId AddRule(RuleFunc* func) {
-		i32 curr_page_count = memory.used / PAGE_SIZE;
-		i32 next_page_count = (memory.used + sizeof(RuleFunc*)) / PAGE_SIZE;
-		if (next_page_count > curr_page_count) {
-			u8* page_alloc_addr = memory.base + next_page_count * PAGE_SIZE;
-			CommitPage(page_alloc_addr, 1);
+	//NOTE: inputs is indexed by RuleId, rules without inputs have a count of 0
+	void SetRuleInputs(RuleInputs* rule_inputs, ConditionTables* tables) {
+		inputs = rule_inputs;
+		input_tables = tables;
+	}
+
+	//NOTE: prefetching runs as a pipeline one stride apart so each step only touches memory the step
+	//before already asked for: the func slot and input list three strides ahead, the code and the input
+	//condition refs two ahead, the condition values one ahead. See SortRulesForLocality for ordering a batch.
+	void RunRules(RuleId* rules, u32 count) {
+		RuleFunc** funcs = (RuleFunc**)memory.base;
+		for (u32 i = 0; i < count; i++) {
+			if (i + 3 * RULE_PREFETCH_DISTANCE < count) {
+				RuleId ahead = rules[i + 3 * RULE_PREFETCH_DISTANCE];
+				Prefetch(funcs + ahead);
+				if (inputs) {
+					Prefetch(inputs + ahead);
+				}
+			}
+			if (i + 2 * RULE_PREFETCH_DISTANCE < count) {
+				RuleId ahead = rules[i + 2 * RULE_PREFETCH_DISTANCE];
+				Prefetch((void*)funcs[ahead]);
+				if (inputs) {
+					Prefetch(inputs[ahead].conditions);
+				}
+			}
+			if (inputs && i + RULE_PREFETCH_DISTANCE < count) {
+				RuleInputs* ahead_inputs = inputs + rules[i + RULE_PREFETCH_DISTANCE];
+				for (u32 c = 0; c < ahead_inputs->count; c++) {
+					PrefetchCondition(input_tables, ahead_inputs->conditions[c]);
+				}
+			}
+			RuleId rule = rules[i];
+			DASSERT(rule * sizeof(void*) < memory.used);
+			current_rule = rule;
+			funcs[rule]();
 		}
+	}
+
+	RuleId AddRule(RuleFunc* func) {
 		RuleFunc** func_slot = PushType(&memory, RuleFunc*);
 		*func_slot = func;
 		i32 result = memory.used / sizeof(RuleFunc*) - 1;
 		return (RuleId)result;
 	}
 };
+
+thread_local RuleId RuleTable::current_rule;
+
+struct ConditionTables {
+	BoolTable* bool_table;
+	CharTable* char_table;
+	FloatTable* float_table;
+	StringTable* string_table;
+	IntTable* int_table;
+};
+
+inline b8 ConditionRefsEqual(ConditionRef a, ConditionRef b) {
+	return a.table == b.table && a.id == b.id;
+}
+
+void PrefetchCondition(ConditionTables* tables, ConditionRef condition) {
+	switch (condition.table) {
+		case CONDITION_TABLE_BOOL:   Prefetch(tables->bool_table->memory.base + condition.id); break;
+		case CONDITION_TABLE_CHAR:   Prefetch(tables->char_table->memory.base + condition.id); break;
+		case CONDITION_TABLE_FLOAT:  Prefetch((f32*)tables->float_table->memory.base + condition.id); break;
+		case CONDITION_TABLE_STRING: Prefetch((i32*)tables->string_table->look_aside_memory.base + condition.id); break;
+		case CONDITION_TABLE_INT:    Prefetch((i64*)tables->int_table->memory.base + condition.id); break;
+		default: break;
+	}
+}
+
+void SetConditionValue(ConditionTables* tables, ConditionRef condition, Value value) {
+	switch (condition.table) {
+		case CONDITION_TABLE_BOOL:   tables->bool_table->SetConditionValue((BoolConditionId)condition.id, AsBool(value)); break;
+		case CONDITION_TABLE_CHAR:   tables->char_table->SetConditionValue((CharConditionId)condition.id, (u8)AsInt(value)); break;
+		case CONDITION_TABLE_FLOAT:  tables->float_table->SetConditionValue((FloatConditionId)condition.id, AsNumber(value)); break;
+		case CONDITION_TABLE_STRING: {
+			String string = AsStringView(value);
+			if (string.length > STRING_MAX_LENGTH) {
+				DERROR("SetConditionValue - string condition %u can't hold %u bytes, longest is %d", condition.id, string.length, STRING_MAX_LENGTH);
+				break;
+			}
+			tables->string_table->SetConditionValue((StringConditionId)condition.id, string);
+		} break;
+		case CONDITION_TABLE_INT:    tables->int_table->SetConditionValue((IntConditionId)condition.id, AsInt(value)); break;
+		default: INVALID_CODE_PATH;
+	}
+}
+
+//NOTE: a write made from another thread, handed to whoever owns the tables through a ring. String values
+//are views, the producer has to keep what they point at alive until the update has been applied.
+struct ConditionUpdate {
+	ConditionRef condition;
+	Value value;
+};
+
+#define CONDITION_UPDATE_BATCH 64
+
+//NOTE: drains up to max_updates in the order they were queued, returns how many were applied
+u32 ApplyConditionUpdates(ConditionTables* tables, MpmcRing<ConditionUpdate>* updates, u32 max_updates) {
+	ConditionUpdate batch[CONDITION_UPDATE_BATCH];
+	u32 applied = 0;
+	while (applied < max_updates) {
+		u32 count = MpmcRingPopBatch(updates, batch, Minimum(max_updates - applied, CONDITION_UPDATE_BATCH));
+		if (count == 0) {
+			break;
+		}
+		for (u32 i = 0; i < count; i++) {
+			SetConditionValue(tables, batch[i].condition, batch[i].value);
+		}
+		applied += count;
+	}
+	return applied;
+}
+
+//NOTE: chars come back as ints so they can be compared against script constants
+Value QueryConditionValue(ConditionTables* tables, ConditionRef condition) {
+	switch (condition.table) {
+		case CONDITION_TABLE_BOOL:   return BoolVal(tables->bool_table->QueryCondition((BoolConditionId)condition.id));
+		case CONDITION_TABLE_CHAR:   return IntVal(tables->char_table->QueryCondition((CharConditionId)condition.id));
+		case CONDITION_TABLE_FLOAT:  return NumberVal(tables->float_table->QueryCondition((FloatConditionId)condition.id));
+		case CONDITION_TABLE_STRING: return StringVal(tables->string_table->QueryConditionString((StringConditionId)condition.id));
+		case CONDITION_TABLE_INT:    return IntVal(tables->int_table->QueryCondition((IntConditionId)condition.id));
+	}
+	INVALID_CODE_PATH;
+	return NilVal();
+}
@@ -1,3 +1,19 @@
+#pragma once
+#include <atomic>
+#include "condition_index.h"
+
+//NOTE: how much a table commits at a time as it grows
+#define TABLE_COMMIT_STEP KiloBytes(64)
+
+//NOTE: string table slots start with their size and the string's length, one byte each. The size counts
+//the terminator, so the longest string a slot holds is one short of what a byte can count.
+#define STRING_SLOT_HEADER 2
+#define STRING_MAX_LENGTH 254
+
+//NOTE: builds the write hook RuleMemo records rules through into every plain table write, leave it
+//off unless rules are memoized
+//#define RULE_MEMO_ENABLED
+
 enum BoolConditionId {
 	GATE_1_OPEN,
 	GATE_2_OPEN,
@@ -22,9 +38,49 @@ enum FloatConditionId {
 	FLOAT3_VALUE
 };
 
+enum IntConditionId {
+	INT1_VALUE,
+	INT2_VALUE,
+	INT3_VALUE
+};
+
 enum RuleId {
 	OPEN_GATE_3,
 	CHANGE_CHAR3,
 	CHANGE_FLOAT3,
 	CHANGE_STRING
-};
\ No newline at end of file
+};
+
+enum ConditionTableType {
+	CONDITION_TABLE_BOOL,
+	CONDITION_TABLE_CHAR,
+	CONDITION_TABLE_FLOAT,
+	CONDITION_TABLE_STRING,
+	CONDITION_TABLE_INT,
+	CONDITION_TABLE_COUNT
+};
+
+//NOTE: identifies a single condition slot independent of which table it lives in
+struct ConditionRef {
+	ConditionTableType table;
+	u32 id;
+};
+
+//NOTE: the conditions a rule reads, RunRules prefetches them before the rule runs
+struct RuleInputs {
+	ConditionRef* conditions;
+	u32 count;
+};
+
+struct ConditionTables;
+void PrefetchCondition(ConditionTables* tables, ConditionRef condition);
+
+//NOTE: a table with a network attached reports every plain SetConditionValue to it
+struct ReteNetwork;
+void ReteConditionChanged(ReteNetwork* net, ConditionRef condition);
+
+//NOTE: a table with snapshots attached writes through to them, see ConditionSnapshotsAttach
+struct Value;
+struct ConditionSnapshots;
+void SnapshotConditionAdded(ConditionSnapshots* snapshots, ConditionRef condition, Value value);
+void SnapshotConditionSet(ConditionSnapshots* snapshots, ConditionRef condition, Value value);
@@ -1,5 +1,8 @@
 #include "dmemory.h"
+#include "../platform_services.h"
+#include "logger.h"
 #include <memory>
+#include <string.h>
 
 #define PushStruct(arena, type) (type*)PushSize_(arena, sizeof(type))
 #define PushType(arena, type) (type*)PushSize_(arena, sizeof(type))
@@ -11,8 +14,24 @@
 #define PushArrayStack(arena, count, type) (type*)PushSizeStack_(arena, (count) * sizeof(type))
 #define PushSizeStack(arena, size) (u8*)PushSizeStack_(arena, size)
 
+//NOTE: slow path of a push into a growing arena, commits whole steps up to and past end
+static void ArenaGrow(MemoryArena* arena, u64 end) {
+    DASSERT(arena->commit_step);
+    u64 new_committed = (end + arena->commit_step - 1) / arena->commit_step * arena->commit_step;
+    new_committed = Minimum(new_committed, arena->size);
+    u64 first_page = arena->committed / PAGE_SIZE;
+    u64 end_page = (new_committed + PAGE_SIZE - 1) / PAGE_SIZE;
+    void* committed = CommitPage(arena->base + first_page * PAGE_SIZE, (u32)(end_page - first_page));
+    DASSERT(committed);
+    arena->committed = new_committed;
+    arena->commit_count++;
+}
+
 void* PushCopy_(MemoryArena* arena, void* src, u64 size) {
     DASSERT((arena->used + size) <= arena->size);
+    if (arena->used + size > arena->committed) {
+        ArenaGrow(arena, arena->used + size);
+    }
     void* result = arena->base + arena->used;
     memcpy(result, src, size);
     arena->used += size;
@@ -22,27 +41,236 @@ void* PushCopy_(MemoryArena* arena, void* src, u64 size) {
 
 void* PushSize_(MemoryArena* arena, size_t size) {
     DASSERT((arena->used + size) <= arena->size);
+    if (arena->used + size > arena->committed) {
+        ArenaGrow(arena, arena->used + size);
+    }
     void* result = arena->base + arena->used;
     arena->used += size;
 
     return result;
 }
 
+//NOTE: for memory that is already committed, the arena never commits anything itself
 static void InitializeArena(MemoryArena* arena, u64 size, u8* base) {
     arena->size = size;
     arena->base = base;
     arena->used = 0;
+    arena->committed = size;
+    arena->commit_step = 0;
+    arena->peak = 0;
+    arena->commit_count = 0;
+    arena->temp_count = 0;
+}
+
+//NOTE: reserves size once, initial_commit bytes are committed now and the rest as pushes need it.
+//commit_step is rounded up to whole pages.
+static b32 InitializeGrowingArena(MemoryArena* arena, u64 size, u64 commit_step, u64 initial_commit = 0, u8* base_address = 0) {
+    size = (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    u8* base = (u8*)ReservePage(base_address, (u32)(size / PAGE_SIZE));
+    if (!base) {
+        return false;
+    }
+    arena->size = size;
+    arena->base = base;
+    arena->used = 0;
+    arena->committed = 0;
+    arena->peak = 0;
+    arena->commit_count = 0;
+    arena->temp_count = 0;
+    arena->commit_step = Maximum((commit_step + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE, (u64)PAGE_SIZE);
+    if (initial_commit) {
+        ArenaGrow(arena, Minimum(initial_commit, size));
+    }
+    return true;
+}
+
+//NOTE: drops everything pushed past mark and, for a growing arena, hands back the whole pages
+//above it. Pushes past mark commit them again.
+static void ArenaDecommitAbove(MemoryArena* arena, u64 mark) {
+    DASSERT(mark <= arena->used);
+    arena->peak = Maximum(arena->peak, arena->used);
+    arena->used = mark;
+    if (!arena->commit_step) {
+        return;
+    }
+    u64 keep = (mark + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    if (keep < arena->committed) {
+        DecommitPage(arena->base + keep, (u32)((arena->committed - keep) / PAGE_SIZE));
+        arena->committed = keep;
+    }
+}
+
+static TempMemory BeginTempMemory(MemoryArena* arena) {
+    arena->temp_count++;
+    return {arena, arena->used};
 }
 
+//NOTE: O(1), nothing is cleared. Temps on one arena have to end in the reverse order they began.
+static void EndTempMemory(TempMemory temp) {
+    MemoryArena* arena = temp.arena;
+    DASSERT(arena->temp_count > 0 && arena->used >= temp.used);
+    arena->peak = Maximum(arena->peak, arena->used);
+    arena->used = temp.used;
+    arena->temp_count--;
+}
+
+#define SCRATCH_ARENA_COUNT 2
+#define SCRATCH_ARENA_SIZE GigaBytes(1)
+#define SCRATCH_COMMIT_STEP KiloBytes(64)
+
+//NOTE: a growing arena's whole reservation goes back, it can't be pushed to again until it's initialized
+static void ArenaRelease(MemoryArena* arena) {
+    DASSERT(arena->commit_step && arena->temp_count == 0);
+    ReleasePage(arena->base, (u32)(arena->size / PAGE_SIZE));
+    *arena = {};
+}
+
+//NOTE: reserved on a thread's first GetScratch, pages stay committed after a release so reuse is free.
+//The reservations go back when the thread exits, so short lived threads don't leak address space.
+struct ScratchArenas {
+    MemoryArena arenas[SCRATCH_ARENA_COUNT];
+
+    ~ScratchArenas() {
+        for (u32 i = 0; i < SCRATCH_ARENA_COUNT; i++) {
+            if (arenas[i].base) {
+                ArenaRelease(arenas + i);
+            }
+        }
+    }
+};
+
+static thread_local ScratchArenas scratch_arenas;
+
+//NOTE: conflicts are arenas the caller is already allocating results into. If a caller was handed a
+//scratch arena by its own caller and pushes into it, handing it back here would free those pushes when
+//this scratch is released, so it is skipped. Two scratch arenas are enough for any chain of such calls
+//because each one only has to avoid the arena its results go into.
+static TempMemory GetScratch(MemoryArena** conflicts = 0, u32 conflict_count = 0) {
+    for (u32 i = 0; i < SCRATCH_ARENA_COUNT; i++) {
+        MemoryArena* scratch = scratch_arenas.arenas + i;
+        b32 conflicting = false;
+        for (u32 j = 0; j < conflict_count && !conflicting; j++) {
+            conflicting = conflicts[j] == scratch;
+        }
+        if (conflicting) {
+            continue;
+        }
+        if (!scratch->base) {
+            b32 reserved = InitializeGrowingArena(scratch, SCRATCH_ARENA_SIZE, SCRATCH_COMMIT_STEP);
+            DASSERT(reserved);
+        }
+        return BeginTempMemory(scratch);
+    }
+    INVALID_CODE_PATH;
+    return {};
+}
+
+static void ReleaseScratch(TempMemory scratch) {
+    EndTempMemory(scratch);
+}
+
+//NOTE: only the committed part, a growing arena's reserved pages past it would fault
 static void ArenaZeroMemory(MemoryArena* arena) {
-    memset(arena->base, 0, arena->size);
+    memset(arena->base, 0, arena->committed);
 }
 
 static void ArenaReset(MemoryArena* arena) {
     ArenaZeroMemory(arena);
+    arena->peak = Maximum(arena->peak, arena->used);
     arena->used = 0;
 }
 
+static ArenaRegistry arena_registry;
+
+static void ArenaRegistryLock() {
+    while (arena_registry.locked.exchange(true, std::memory_order_acquire)) {
+        while (arena_registry.locked.load(std::memory_order_relaxed)) {
+            SpinPause();
+        }
+    }
+}
+
+static void ArenaRegistryUnlock() {
+    arena_registry.locked.store(false, std::memory_order_release);
+}
+
+//NOTE: name isn't copied, it has to outlive the registration
+static void ArenaRegister(MemoryArena* arena, char* name) {
+    ArenaRegistryLock();
+    u32 slot = 0;
+    while (slot < arena_registry.count && arena_registry.arenas[slot] != arena) {
+        slot++;
+    }
+    if (slot == arena_registry.count) {
+        DASSERT(arena_registry.count < ARENA_REGISTRY_MAX);
+        arena_registry.count++;
+    }
+    arena_registry.arenas[slot] = arena;
+    arena_registry.names[slot] = name;
+    ArenaRegistryUnlock();
+}
+
+//NOTE: has to happen before an arena that's going away stops being valid memory
+static void ArenaUnregister(MemoryArena* arena) {
+    ArenaRegistryLock();
+    for (u32 i = 0; i < arena_registry.count; i++) {
+        if (arena_registry.arenas[i] == arena) {
+            arena_registry.count--;
+            arena_registry.arenas[i] = arena_registry.arenas[arena_registry.count];
+            arena_registry.names[i] = arena_registry.names[arena_registry.count];
+            break;
+        }
+    }
+    ArenaRegistryUnlock();
+}
+
+//NOTE: a few plain loads per arena, no locks on the arenas themselves. Arenas other threads are pushing
+//into are read racily, so their numbers are only as fresh as the last push this thread can see.
+static u32 ArenaStatsSnapshot(ArenaStats* stats, u32 max_stats) {
+    ArenaRegistryLock();
+    u32 count = Minimum(arena_registry.count, max_stats);
+    for (u32 i = 0; i < count; i++) {
+        MemoryArena* arena = arena_registry.arenas[i];
+        ArenaStats* stat = stats + i;
+        stat->name = arena_registry.names[i];
+        stat->reserved = arena->size;
+        stat->committed = arena->committed;
+        stat->used = arena->used;
+        stat->peak = Maximum(arena->peak, stat->used);
+        stat->commit_count = arena->commit_count;
+    }
+    ArenaRegistryUnlock();
+    return count;
+}
+
+static void ArenaStatsDump() {
+    ArenaStats stats[ARENA_REGISTRY_MAX];
+    u32 count = ArenaStatsSnapshot(stats, ARENA_REGISTRY_MAX);
+    u64 total_reserved = 0;
+    u64 total_committed = 0;
+    u64 total_used = 0;
+    DINFO("%-24s %12s %12s %12s %12s %8s", "arena", "reserved KB", "committed KB", "used KB", "peak KB", "commits");
+    for (u32 i = 0; i < count; i++) {
+        ArenaStats* stat = stats + i;
+        DINFO("%-24s %12llu %12llu %12llu %12llu %8u", stat->name, stat->reserved / 1024, stat->committed / 1024,
+            stat->used / 1024, stat->peak / 1024, stat->commit_count);
+        total_reserved += stat->reserved;
+        total_committed += stat->committed;
+        total_used += stat->used;
+    }
+    DINFO("%-24s %12llu %12llu %12llu", "total", total_reserved / 1024, total_committed / 1024, total_used / 1024);
+}
+
+//NOTE: for calling from a loop, dumps at most once every interval_seconds
+static void ArenaStatsDumpEvery(f64 interval_seconds) {
+    static f64 last_dump;
+    f64 now = PlatformGetSeconds();
+    if (now - last_dump >= interval_seconds) {
+        last_dump = now;
+        ArenaStatsDump();
+    }
+}
+
 static void MemCopy(void* src, void* dst, u64 size) {
     memcpy(dst, src, size);
 }
@@ -51,6 +279,16 @@ static void MemMove(void* src, void* dst, u64 size) {
     memmove(dst, src, size);
 }
 
+//NOTE: FNV-1a, good enough for the small keys the hash tables use
+static u32 HashBytes(void* data, u64 size, u32 hash = 2166136261u) {
+    u8* bytes = (u8*)data;
+    for (u64 i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 template <typename T>
 static u32 CircularArrayMask(CircularArray<T>* array, u32 val) {
     u32 result = val & (array->capacity - 1);
@@ -77,6 +315,15 @@ static b32 IsPowOf2(u32 val) {
     return result;
 }
 
+//NOTE: never returns 1 since IsPowOf2 doesn't count it
+static u32 RoundUpPowOf2(u32 val) {
+    u32 result = 2;
+    while (result < val) {
+        result <<= 1;
+    }
+    return result;
+}
+
 //NOTE: maybe make a version later on that can take any size and work the original way or expand to a power of 2 for the user
 template<typename T>
 static void CircularArrayInit(MemoryArena* arena, CircularArray<T>* array, u32 count) {
@@ -134,58 +381,350 @@ static T QueuePop(Queue<T>* queue) {
     return CircularArrayPop(&queue->data);
 }
 
-static void PoolInitWithBackBuffer(u8* pool_buffer, MemoryArena* arena, Pool* pool, u32 num_slots, u32 slot_size) {
-    pool->slots = PushArray(arena, num_slots, PoolSlot);
-    for (u32 slot = 0; slot < num_slots; slot++) {
-        *(pool->slots + slot) = {
-            .data = pool->base_addr + slot * pool->slot_size,
-            .space_used = 0
-        };
+template<typename T>
+static void SpscRingInit(MemoryArena* arena, SpscRing<T>* ring, u32 count) {
+    DASSERT(IsPowOf2(count));
+    ring->back.store(0, std::memory_order_relaxed);
+    ring->front.store(0, std::memory_order_relaxed);
+    ring->front_cache = 0;
+    ring->back_cache = 0;
+    ring->capacity = count;
+    ring->data = PushArray(arena, count, T);
+}
+
+//NOTE: producer side, wait-free. Returns how many of objects fit, they go in order.
+template<typename T>
+static u32 SpscRingPushBatch(SpscRing<T>* ring, T* objects, u32 count) {
+    u32 back = ring->back.load(std::memory_order_relaxed);
+    u32 space = ring->capacity - (back - ring->front_cache);
+    if (space < count) {
+        ring->front_cache = ring->front.load(std::memory_order_acquire);
+        space = ring->capacity - (back - ring->front_cache);
     }
-    QueueInit(arena, &pool->free_list, num_slots);
-    for (u32 i = 0; i < num_slots; i++) {
-        QueuePush(&pool->free_list, i);
+    count = Minimum(count, space);
+    u32 mask = ring->capacity - 1;
+    for (u32 i = 0; i < count; i++) {
+        ring->data[(back + i) & mask] = objects[i];
     }
+    ring->back.store(back + count, std::memory_order_release);
+    return count;
+}
+
+template<typename T>
+static b32 SpscRingPush(SpscRing<T>* ring, T object) {
+    return SpscRingPushBatch(ring, &object, 1) == 1;
+}
+
+//NOTE: consumer side, wait-free
+template<typename T>
+static u32 SpscRingPopBatch(SpscRing<T>* ring, T* objects, u32 max_count) {
+    u32 front = ring->front.load(std::memory_order_relaxed);
+    u32 available = ring->back_cache - front;
+    if (available < max_count) {
+        ring->back_cache = ring->back.load(std::memory_order_acquire);
+        available = ring->back_cache - front;
+    }
+    u32 count = Minimum(max_count, available);
+    u32 mask = ring->capacity - 1;
+    for (u32 i = 0; i < count; i++) {
+        objects[i] = ring->data[(front + i) & mask];
+    }
+    ring->front.store(front + count, std::memory_order_release);
+    return count;
+}
+
+template<typename T>
+static b32 SpscRingPop(SpscRing<T>* ring, T* object) {
+    return SpscRingPopBatch(ring, object, 1) == 1;
+}
+
+template<typename T>
+static void MpmcRingInit(MemoryArena* arena, MpmcRing<T>* ring, u32 count) {
+    DASSERT(IsPowOf2(count));
+    ring->back.store(0, std::memory_order_relaxed);
+    ring->front.store(0, std::memory_order_relaxed);
+    ring->capacity = count;
+    ring->slots = PushArray(arena, count, MpmcSlot<T>);
+    for (u32 i = 0; i < count; i++) {
+        ring->slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+//NOTE: claims the longest run of ready slots up to count with one CAS on back, then fills them.
+//Nobody else can touch a claimed slot until its sequence is published, so the fill needs no more sync.
+//Lock-free, a producer only retries when another one claimed the same slots first.
+template<typename T>
+static u32 MpmcRingPushBatch(MpmcRing<T>* ring, T* objects, u32 count) {
+    if (count == 0) {
+        return 0;
+    }
+    u32 mask = ring->capacity - 1;
+    u32 back = ring->back.load(std::memory_order_relaxed);
+    for (;;) {
+        u32 ready = 0;
+        while (ready < count && ring->slots[(back + ready) & mask].sequence.load(std::memory_order_acquire) == back + ready) {
+            ready++;
+        }
+        if (ready == 0) {
+            i32 lag = (i32)(ring->slots[back & mask].sequence.load(std::memory_order_acquire) - back);
+            if (lag < 0) {
+                return 0;
+            }
+            back = ring->back.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (ring->back.compare_exchange_weak(back, back + ready, std::memory_order_relaxed)) {
+            for (u32 i = 0; i < ready; i++) {
+                MpmcSlot<T>* slot = ring->slots + ((back + i) & mask);
+                slot->data = objects[i];
+                slot->sequence.store(back + i + 1, std::memory_order_release);
+            }
+            return ready;
+        }
+    }
+}
+
+template<typename T>
+static b32 MpmcRingPush(MpmcRing<T>* ring, T object) {
+    return MpmcRingPushBatch(ring, &object, 1) == 1;
+}
+
+template<typename T>
+static u32 MpmcRingPopBatch(MpmcRing<T>* ring, T* objects, u32 max_count) {
+    if (max_count == 0) {
+        return 0;
+    }
+    u32 mask = ring->capacity - 1;
+    u32 front = ring->front.load(std::memory_order_relaxed);
+    for (;;) {
+        u32 ready = 0;
+        while (ready < max_count && ring->slots[(front + ready) & mask].sequence.load(std::memory_order_acquire) == front + ready + 1) {
+            ready++;
+        }
+        if (ready == 0) {
+            i32 lag = (i32)(ring->slots[front & mask].sequence.load(std::memory_order_acquire) - (front + 1));
+            if (lag < 0) {
+                return 0;
+            }
+            front = ring->front.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (ring->front.compare_exchange_weak(front, front + ready, std::memory_order_relaxed)) {
+            for (u32 i = 0; i < ready; i++) {
+                MpmcSlot<T>* slot = ring->slots + ((front + i) & mask);
+                objects[i] = slot->data;
+                slot->sequence.store(front + i + ring->capacity, std::memory_order_release);
+            }
+            return ready;
+        }
+    }
+}
+
+template<typename T>
+static b32 MpmcRingPop(MpmcRing<T>* ring, T* object) {
+    return MpmcRingPopBatch(ring, object, 1) == 1;
+}
+
+static std::atomic<u32> next_pool_id{1};
+static thread_local PoolThreadCache pool_thread_cache;
+
+//NOTE: everything but the slots arena, which the PoolInit variants set up first
+static void PoolInitState(Pool* pool, u32 num_slots, u32 slot_size) {
+    pool->slot_size = slot_size;
+    pool->max_slots = num_slots;
+    pool->free_head = INVALID_ID;
+    pool->slots_used = 0;
+    pool->id = next_pool_id.fetch_add(1, std::memory_order_relaxed);
+    pool->locked.store(false, std::memory_order_relaxed);
+}
+
+//NOTE: slots are rounded up to 8 bytes so each one can hold a free list link and any of the engine's types
+static u32 PoolSlotSize(u32 slot_size) {
+    return (Maximum(slot_size, (u32)sizeof(u32)) + 7) & ~7u;
+}
+
+static void PoolInitWithBackBuffer(u8* pool_buffer, Pool* pool, u32 num_slots, u32 slot_size) {
+    slot_size = PoolSlotSize(slot_size);
+    InitializeArena(&pool->slots, (u64)num_slots * slot_size, pool_buffer);
+    PoolInitState(pool, num_slots, slot_size);
 }
 
 static void PoolInit(MemoryArena* arena, Pool* pool, u32 num_slots, u32 slot_size) {
-    pool->base_addr = PushSize(arena, slot_size*num_slots); 
-    PoolInitWithBackBuffer(pool->base_addr, arena, pool, num_slots, slot_size);
+    slot_size = PoolSlotSize(slot_size);
+    PoolInitWithBackBuffer(PushSize(arena, (u64)num_slots * slot_size), pool, num_slots, slot_size);
 }
 
-static PoolSlot* PoolGetSlot(Pool* pool, u32 slot) {
-    return &pool->slots[slot];
+//NOTE: only reserves the slots, pages are committed commit_step at a time as the pool first reaches them
+static b32 PoolInitGrowing(Pool* pool, u32 num_slots, u32 slot_size, u64 commit_step = KiloBytes(64)) {
+    slot_size = PoolSlotSize(slot_size);
+    if (!InitializeGrowingArena(&pool->slots, (u64)num_slots * slot_size, commit_step)) {
+        return false;
+    }
+    PoolInitState(pool, num_slots, slot_size);
+    return true;
 }
 
-static void PoolPushWithinSlot(Pool* pool, void* data, u32 slot, u32 size, b32 overwrite = false) {
-    DASSERT(slot < pool->max_slots);
-    if (overwrite) {
-        MemCopy(data, pool->slots[slot].data, pool->slot_size);
+static void* PoolSlotPointer(Pool* pool, u32 slot) {
+    return pool->slots.base + (u64)slot * pool->slot_size;
+}
+
+//NOTE: checked against the pool's fixed size, slots.used can be moving under another thread's lock
+static u32 PoolSlotIndex(Pool* pool, void* data) {
+    u64 offset = (u8*)data - pool->slots.base;
+    DASSERT(offset < (u64)pool->max_slots * pool->slot_size && offset % pool->slot_size == 0);
+    return (u32)(offset / pool->slot_size);
+}
+
+//NOTE: INVALID_ID once every slot is out
+static u32 PoolTakeSlot(Pool* pool) {
+    u32 slot = pool->free_head;
+    if (slot != INVALID_ID) {
+        pool->free_head = *(u32*)PoolSlotPointer(pool, slot);
+    }
+    else if (pool->slots.used / pool->slot_size < pool->max_slots) {
+        PushSize(&pool->slots, pool->slot_size);
+        slot = (u32)(pool->slots.used / pool->slot_size) - 1;
+    }
+    else {
+        return INVALID_ID;
     }
-    MemCopy(data, pool->slots[slot].data, pool->slot_size);
     pool->slots_used++;
+    return slot;
 }
 
-static void PoolPushToSlot(Pool* pool, void* data, u32 slot) {
-    DASSERT(slot < pool->max_slots);
-    MemCopy(data, pool->slots[slot].data, pool->slot_size);
-    pool->slots_used++;
+static void PoolReturnSlot(Pool* pool, u32 slot) {
+    DASSERT(pool->slots_used > 0 && (u64)slot * pool->slot_size < pool->slots.used);
+    *(u32*)PoolSlotPointer(pool, slot) = pool->free_head;
+    pool->free_head = slot;
+    pool->slots_used--;
 }
 
-static void PoolPush(Pool* pool, void* data) {
-    u32 free_slot = QueuePop(&pool->free_list);
-    PoolPushToSlot(pool, data, free_slot);
+//NOTE: 0 when the pool is full. Contents of a recycled slot are whatever was last written to it.
+static void* PoolAlloc(Pool* pool) {
+    u32 slot = PoolTakeSlot(pool);
+    return slot == INVALID_ID ? 0 : PoolSlotPointer(pool, slot);
 }
 
+static void PoolFree(Pool* pool, void* data) {
+    PoolReturnSlot(pool, PoolSlotIndex(pool, data));
+}
 
-static void InitializeArena(PoolArena* arena, u32 num_slots, u32 slot_size, u8* base) {
-    arena->pool.max_slots = num_slots;
-    arena->pool.slot_size = slot_size;
-    u32 memory_for_slot_buffer = num_slots * slot_size;
-    u32 memory_for_pool_slots = num_slots * sizeof(PoolSlot);
-    u32 total_memory_needed = memory_for_slot_buffer + memory_for_pool_slots;
+static void* PoolPush(Pool* pool, void* data, u32 size) {
+    DASSERT(size <= pool->slot_size);
+    void* slot = PoolAlloc(pool);
+    if (slot) {
+        MemCopy(data, slot, size);
+    }
+    return slot;
+}
 
-    InitializeArena(&arena->storage, total_memory_needed, base);
-    PoolInit(&arena->storage, &arena->pool, num_slots, slot_size);
+static void PoolLock(Pool* pool) {
+    while (pool->locked.exchange(true, std::memory_order_acquire)) {
+        while (pool->locked.load(std::memory_order_relaxed)) {
+            SpinPause();
+        }
+    }
+}
+
+static void PoolUnlock(Pool* pool) {
+    pool->locked.store(false, std::memory_order_release);
+}
+
+//NOTE: 0 when all of this thread's magazines are taken by other pools, that pool then goes straight
+//to the shared free list
+static PoolMagazine* PoolThreadMagazine(Pool* pool) {
+    PoolMagazine* unused = 0;
+    for (u32 i = 0; i < POOL_MAX_THREAD_CACHES; i++) {
+        PoolMagazine* magazine = pool_thread_cache.magazines + i;
+        if (magazine->pool_id == pool->id) {
+            return magazine;
+        }
+        if (!unused && magazine->pool_id == 0) {
+            unused = magazine;
+        }
+    }
+    if (unused) {
+        unused->pool = pool;
+        unused->pool_id = pool->id;
+        unused->count = 0;
+    }
+    return unused;
+}
+
+//NOTE: the lock is only taken to move half a magazine at a time, so threads allocating and freeing
+//mostly stay off it
+static void* PoolAllocConcurrent(Pool* pool) {
+    PoolMagazine* magazine = PoolThreadMagazine(pool);
+    if (!magazine) {
+        PoolLock(pool);
+        u32 slot = PoolTakeSlot(pool);
+        PoolUnlock(pool);
+        return slot == INVALID_ID ? 0 : PoolSlotPointer(pool, slot);
+    }
+    if (magazine->count == 0) {
+        PoolLock(pool);
+        while (magazine->count < POOL_MAGAZINE_SIZE / 2) {
+            u32 slot = PoolTakeSlot(pool);
+            if (slot == INVALID_ID) {
+                break;
+            }
+            magazine->slots[magazine->count++] = slot;
+        }
+        PoolUnlock(pool);
+        if (magazine->count == 0) {
+            return 0;
+        }
+    }
+    return PoolSlotPointer(pool, magazine->slots[--magazine->count]);
+}
+
+static void PoolFreeConcurrent(Pool* pool, void* data) {
+    u32 slot = PoolSlotIndex(pool, data);
+    PoolMagazine* magazine = PoolThreadMagazine(pool);
+    if (!magazine) {
+        PoolLock(pool);
+        PoolReturnSlot(pool, slot);
+        PoolUnlock(pool);
+        return;
+    }
+    if (magazine->count == POOL_MAGAZINE_SIZE) {
+        PoolLock(pool);
+        while (magazine->count > POOL_MAGAZINE_SIZE / 2) {
+            PoolReturnSlot(pool, magazine->slots[--magazine->count]);
+        }
+        PoolUnlock(pool);
+    }
+    magazine->slots[magazine->count++] = slot;
+}
+
+static void PoolFlushMagazine(PoolMagazine* magazine) {
+    Pool* pool = magazine->pool;
+    PoolLock(pool);
+    while (magazine->count > 0) {
+        PoolReturnSlot(pool, magazine->slots[--magazine->count]);
+    }
+    PoolUnlock(pool);
+    magazine->pool = 0;
+    magazine->pool_id = 0;
+}
+
+//NOTE: hands this thread's cached slots back early, exiting the thread does the same
+static void PoolFlushThreadCache(Pool* pool) {
+    for (u32 i = 0; i < POOL_MAX_THREAD_CACHES; i++) {
+        PoolMagazine* magazine = pool_thread_cache.magazines + i;
+        if (magazine->pool_id == pool->id) {
+            PoolFlushMagazine(magazine);
+        }
+    }
+}
+
+//NOTE: a magazine whose pool has since been initialized again has a stale id and is dropped
+PoolThreadCache::~PoolThreadCache() {
+    for (u32 i = 0; i < POOL_MAX_THREAD_CACHES; i++) {
+        PoolMagazine* magazine = magazines + i;
+        if (magazine->pool_id && magazine->pool->id == magazine->pool_id) {
+            PoolFlushMagazine(magazine);
+        }
+    }
 }
 
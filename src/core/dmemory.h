@@ -1,9 +1,44 @@
 #pragma once
+#include <atomic>
 
+//NOTE: committed is how much of the range past base is backed. A growing arena (commit_step != 0) has
+//the whole size reserved and commits commit_step bytes at a time as pushes reach committed.
+//peak is only brought up to date when used goes down, the real high water mark is Maximum(peak, used).
 struct MemoryArena {
     u64 size;
     u8* base;
     u64 used;
+    u64 committed;
+    u64 commit_step;
+    u64 peak;
+    u32 commit_count;
+    u32 temp_count;
+};
+
+#define ARENA_REGISTRY_MAX 128
+
+//NOTE: arenas register once under a name so ArenaStatsSnapshot can see every subsystem's memory.
+//Registering the same arena again just renames it.
+struct ArenaRegistry {
+    MemoryArena* arenas[ARENA_REGISTRY_MAX];
+    char* names[ARENA_REGISTRY_MAX];
+    u32 count;
+    std::atomic<b32> locked;
+};
+
+struct ArenaStats {
+    char* name;
+    u64 reserved;
+    u64 committed;
+    u64 used;
+    u64 peak;
+    u32 commit_count;
+};
+
+//NOTE: where an arena was when a temporary use of it began, ending it frees everything pushed since
+struct TempMemory {
+    MemoryArena* arena;
+    u64 used;
 };
 
 struct Stack {
@@ -26,22 +61,63 @@ struct Queue {
     CircularArray<type> data;
 };
 
-struct PoolSlot {
-    u8* data;
-    u32 space_used;
+//NOTE: one producer thread and one consumer thread. Each side keeps a cached copy of the other side's
+//index so it only reads the shared one when the cached copy says the ring looks full or empty.
+template<typename type>
+struct SpscRing {
+    alignas(64) std::atomic<u32> back; //NOTE: only the producer writes back
+    u32 front_cache;
+    alignas(64) std::atomic<u32> front; //NOTE: only the consumer writes front
+    u32 back_cache;
+    alignas(64) u32 capacity; //NOTE: this must always be a power of 2!
+    type* data;
 };
 
+//NOTE: sequence is the index the slot is next ready for. A producer may fill it when it equals the
+//producer's index, a consumer may empty it when it equals the consumer's index + 1.
+template<typename type>
+struct MpmcSlot {
+    std::atomic<u32> sequence;
+    type data;
+};
+
+template<typename type>
+struct MpmcRing {
+    alignas(64) std::atomic<u32> back;
+    alignas(64) std::atomic<u32> front;
+    alignas(64) u32 capacity; //NOTE: this must always be a power of 2!
+    MpmcSlot<type>* slots;
+};
+
+#define POOL_MAGAZINE_SIZE 32
+#define POOL_MAX_THREAD_CACHES 8
+
+//NOTE: fixed size slots carved from slots in order. A free slot holds the index of the next free one,
+//so the free list costs no memory. Like the condition tables a pool is used either through PoolAlloc/
+//PoolFree from one thread or through the Concurrent versions, not both.
 struct Pool {
-    u8* base_addr;
+    MemoryArena slots;
     u32 slot_size;
     u32 max_slots;
-    u32 slots_used;
-    PoolSlot* slots;
-    Queue<u32> free_list;
+    u32 free_head;
+    u32 slots_used; //NOTE: in concurrent mode this includes slots sitting in thread caches
+    u32 id;
+    std::atomic<b32> locked; //NOTE: guards free_head, slots and slots_used in concurrent mode
 };
 
-struct PoolArena {
-    MemoryArena storage;
-    Pool pool;
+//NOTE: a thread's stash of free slots for one pool, most allocations and frees only touch this
+struct PoolMagazine {
+    Pool* pool;
+    u32 pool_id;
+    u32 count;
+    u32 slots[POOL_MAGAZINE_SIZE];
+};
+
+//NOTE: a thread's magazines, whatever is still cached in them goes back to its pool when the thread
+//exits. A pool used through the Concurrent calls has to outlive every thread that used it.
+struct PoolThreadCache {
+    PoolMagazine magazines[POOL_MAX_THREAD_CACHES];
+
+    ~PoolThreadCache();
 };
 
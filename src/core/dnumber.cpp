@@ -0,0 +1,476 @@
+#include <math.h>
+
+//NOTE: length-bounded number parsing for source text, nothing here looks at the locale or past length.
+//Floats are rounded exactly: small ones take the exact float fast path, the rest go through Eisel-Lemire
+//(Lemire, "Number Parsing at a Gigabyte per Second") and the rare inputs with more than 19 significant
+//digits that it can't settle are decided by comparing against the halfway point with big integers.
+
+enum ParseNumberResult {
+    PARSE_NUMBER_OK,
+    PARSE_NUMBER_INVALID,
+    PARSE_NUMBER_OUT_OF_RANGE
+};
+
+//NOTE: value is mantissa * 10^exponent, or a little more when truncated says nonzero digits were dropped
+struct DecimalNumber {
+    u64 mantissa;
+    i64 exponent;
+    b8 negative;
+    b8 truncated;
+    u8* integer;
+    u32 integer_length;
+    u8* fraction;
+    u32 fraction_length;
+    i64 written_exponent;
+};
+
+#define DECIMAL_MAX_DIGITS 19
+#define DECIMAL_EXPONENT_LIMIT 100000
+
+//NOTE: leading zeros add nothing to mantissa or significant, digits past the ones mantissa can hold only
+//count towards significant and truncated
+inline void AddDecimalDigit(u64* mantissa, u32* significant, b8* truncated, u32 digit) {
+    if (*significant < DECIMAL_MAX_DIGITS) {
+        *mantissa = *mantissa * 10 + digit;
+        *significant += (*significant | digit) != 0;
+    } else {
+        (*significant)++;
+        *truncated = *truncated || digit != 0;
+    }
+}
+
+//NOTE: [-]digits[.digits][(e|E)[+|-]digits] with at least one mantissa digit, in a single pass
+static b8 ScanDecimal(u8* str, u32 length, DecimalNumber* number) {
+    u32 i = 0;
+    number->negative = i < length && str[i] == '-';
+    if (number->negative) {
+        i++;
+    }
+    u64 mantissa = 0;
+    u32 significant = 0;
+    b8 truncated = false;
+    number->integer = str + i;
+    for (u32 digit; i < length && (digit = str[i] - '0') <= 9; i++) {
+        AddDecimalDigit(&mantissa, &significant, &truncated, digit);
+    }
+    number->integer_length = (u32)(str + i - number->integer);
+    number->fraction = str + i;
+    number->fraction_length = 0;
+    if (i < length && str[i] == '.') {
+        i++;
+        number->fraction = str + i;
+        for (u32 digit; i < length && (digit = str[i] - '0') <= 9; i++) {
+            AddDecimalDigit(&mantissa, &significant, &truncated, digit);
+        }
+        number->fraction_length = (u32)(str + i - number->fraction);
+    }
+    if (number->integer_length + number->fraction_length == 0) {
+        return false;
+    }
+    number->written_exponent = 0;
+    if (i < length && (str[i] == 'e' || str[i] == 'E')) {
+        i++;
+        b8 negative_exponent = i < length && str[i] == '-';
+        if (i < length && (str[i] == '-' || str[i] == '+')) {
+            i++;
+        }
+        if (i == length || !IsDigit(str[i])) {
+            return false;
+        }
+        for (; i < length && IsDigit(str[i]); i++) {
+            if (number->written_exponent < DECIMAL_EXPONENT_LIMIT) {
+                number->written_exponent = number->written_exponent * 10 + (str[i] - '0');
+            }
+        }
+        if (negative_exponent) {
+            number->written_exponent = -number->written_exponent;
+        }
+    }
+    if (i != length) {
+        return false;
+    }
+    u32 dropped = significant > DECIMAL_MAX_DIGITS ? significant - DECIMAL_MAX_DIGITS : 0;
+    number->mantissa = mantissa;
+    number->exponent = number->written_exponent - number->fraction_length + dropped;
+    number->truncated = truncated;
+    return true;
+}
+
+//NOTE: 5^q for q in [F32_SMALLEST_POWER_OF_TEN, F32_LARGEST_POWER_OF_TEN] as 128 bits with the top bit set,
+//high word first. Below that range every 19 digit mantissa rounds to 0, above it to infinity.
+#define F32_SMALLEST_POWER_OF_TEN -65
+#define F32_LARGEST_POWER_OF_TEN 38
+static u64 f32_powers_of_five[] = {
+    0x86ccbb52ea94baea, 0x98e947129fc2b4e9,
+    0xa87fea27a539e9a5, 0x3f2398d747b36224,
+    0xd29fe4b18e88640e, 0x8eec7f0d19a03aad,
+    0x83a3eeeef9153e89, 0x1953cf68300424ac,
+    0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7,
+    0xcdb02555653131b6, 0x3792f412cb06794d,
+    0x808e17555f3ebf11, 0xe2bbd88bbee40bd0,
+    0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4,
+    0xc8de047564d20a8b, 0xf245825a5a445275,
+    0xfb158592be068d2e, 0xeed6e2f0f0d56712,
+    0x9ced737bb6c4183d, 0x55464dd69685606b,
+    0xc428d05aa4751e4c, 0xaa97e14c3c26b886,
+    0xf53304714d9265df, 0xd53dd99f4b3066a8,
+    0x993fe2c6d07b7fab, 0xe546a8038efe4029,
+    0xbf8fdb78849a5f96, 0xde98520472bdd033,
+    0xef73d256a5c0f77c, 0x963e66858f6d4440,
+    0x95a8637627989aad, 0xdde7001379a44aa8,
+    0xbb127c53b17ec159, 0x5560c018580d5d52,
+    0xe9d71b689dde71af, 0xaab8f01e6e10b4a6,
+    0x9226712162ab070d, 0xcab3961304ca70e8,
+    0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22,
+    0xe45c10c42a2b3b05, 0x8cb89a7db77c506a,
+    0x8eb98a7a9a5b04e3, 0x77f3608e92adb242,
+    0xb267ed1940f1c61c, 0x55f038b237591ed3,
+    0xdf01e85f912e37a3, 0x6b6c46dec52f6688,
+    0x8b61313bbabce2c6, 0x2323ac4b3b3da015,
+    0xae397d8aa96c1b77, 0xabec975e0a0d081a,
+    0xd9c7dced53c72255, 0x96e7bd358c904a21,
+    0x881cea14545c7575, 0x7e50d64177da2e54,
+    0xaa242499697392d2, 0xdde50bd1d5d0b9e9,
+    0xd4ad2dbfc3d07787, 0x955e4ec64b44e864,
+    0x84ec3c97da624ab4, 0xbd5af13bef0b113e,
+    0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e,
+    0xcfb11ead453994ba, 0x67de18eda5814af2,
+    0x81ceb32c4b43fcf4, 0x80eacf948770ced7,
+    0xa2425ff75e14fc31, 0xa1258379a94d028d,
+    0xcad2f7f5359a3b3e, 0x096ee45813a04330,
+    0xfd87b5f28300ca0d, 0x8bca9d6e188853fc,
+    0x9e74d1b791e07e48, 0x775ea264cf55347e,
+    0xc612062576589dda, 0x95364afe032a819e,
+    0xf79687aed3eec551, 0x3a83ddbd83f52205,
+    0x9abe14cd44753b52, 0xc4926a9672793543,
+    0xc16d9a0095928a27, 0x75b7053c0f178294,
+    0xf1c90080baf72cb1, 0x5324c68b12dd6339,
+    0x971da05074da7bee, 0xd3f6fc16ebca5e04,
+    0xbce5086492111aea, 0x88f4bb1ca6bcf585,
+    0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6,
+    0x9392ee8e921d5d07, 0x3aff322e62439fd0,
+    0xb877aa3236a4b449, 0x09befeb9fad487c3,
+    0xe69594bec44de15b, 0x4c2ebe687989a9b4,
+    0x901d7cf73ab0acd9, 0x0f9d37014bf60a11,
+    0xb424dc35095cd80f, 0x538484c19ef38c95,
+    0xe12e13424bb40e13, 0x2865a5f206b06fba,
+    0x8cbccc096f5088cb, 0xf93f87b7442e45d4,
+    0xafebff0bcb24aafe, 0xf78f69a51539d749,
+    0xdbe6fecebdedd5be, 0xb573440e5a884d1c,
+    0x89705f4136b4a597, 0x31680a88f8953031,
+    0xabcc77118461cefc, 0xfdc20d2b36ba7c3e,
+    0xd6bf94d5e57a42bc, 0x3d32907604691b4d,
+    0x8637bd05af6c69b5, 0xa63f9a49c2c1b110,
+    0xa7c5ac471b478423, 0x0fcf80dc33721d54,
+    0xd1b71758e219652b, 0xd3c36113404ea4a9,
+    0x83126e978d4fdf3b, 0x645a1cac083126ea,
+    0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4,
+    0xcccccccccccccccc, 0xcccccccccccccccd,
+    0x8000000000000000, 0x0000000000000000,
+    0xa000000000000000, 0x0000000000000000,
+    0xc800000000000000, 0x0000000000000000,
+    0xfa00000000000000, 0x0000000000000000,
+    0x9c40000000000000, 0x0000000000000000,
+    0xc350000000000000, 0x0000000000000000,
+    0xf424000000000000, 0x0000000000000000,
+    0x9896800000000000, 0x0000000000000000,
+    0xbebc200000000000, 0x0000000000000000,
+    0xee6b280000000000, 0x0000000000000000,
+    0x9502f90000000000, 0x0000000000000000,
+    0xba43b74000000000, 0x0000000000000000,
+    0xe8d4a51000000000, 0x0000000000000000,
+    0x9184e72a00000000, 0x0000000000000000,
+    0xb5e620f480000000, 0x0000000000000000,
+    0xe35fa931a0000000, 0x0000000000000000,
+    0x8e1bc9bf04000000, 0x0000000000000000,
+    0xb1a2bc2ec5000000, 0x0000000000000000,
+    0xde0b6b3a76400000, 0x0000000000000000,
+    0x8ac7230489e80000, 0x0000000000000000,
+    0xad78ebc5ac620000, 0x0000000000000000,
+    0xd8d726b7177a8000, 0x0000000000000000,
+    0x878678326eac9000, 0x0000000000000000,
+    0xa968163f0a57b400, 0x0000000000000000,
+    0xd3c21bcecceda100, 0x0000000000000000,
+    0x84595161401484a0, 0x0000000000000000,
+    0xa56fa5b99019a5c8, 0x0000000000000000,
+    0xcecb8f27f4200f3a, 0x0000000000000000,
+    0x813f3978f8940984, 0x4000000000000000,
+    0xa18f07d736b90be5, 0x5000000000000000,
+    0xc9f2c9cd04674ede, 0xa400000000000000,
+    0xfc6f7c4045812296, 0x4d00000000000000,
+    0x9dc5ada82b70b59d, 0xf020000000000000,
+    0xc5371912364ce305, 0x6c28000000000000,
+    0xf684df56c3e01bc6, 0xc732000000000000,
+    0x9a130b963a6c115c, 0x3c7f400000000000,
+    0xc097ce7bc90715b3, 0x4b9f100000000000,
+    0xf0bdc21abb48db20, 0x1e86d40000000000,
+    0x96769950b50d88f4, 0x1314448000000000
+};
+
+#define F32_MANTISSA_BITS 23
+#define F32_MINIMUM_EXPONENT -127
+#define F32_INFINITE_POWER 0xFF
+
+inline u64 Multiply64To128(u64 a, u64 b, u64* high) {
+#ifdef _MSC_VER
+    return _umul128(a, b, high);
+#else
+    unsigned __int128 product = (unsigned __int128)a * b;
+    *high = (u64)(product >> 64);
+    return (u64)product;
+#endif
+}
+
+inline u32 LeadingZeros64(u64 value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - index;
+#else
+    return __builtin_clzll(value);
+#endif
+}
+
+//NOTE: bits of the float nearest to mantissa * 10^exponent for a mantissa that isn't 0
+static u32 EiselLemireF32(u64 mantissa, i64 exponent) {
+    if (exponent < F32_SMALLEST_POWER_OF_TEN) {
+        return 0;
+    }
+    if (exponent > F32_LARGEST_POWER_OF_TEN) {
+        return F32_INFINITE_POWER << F32_MANTISSA_BITS;
+    }
+    u32 leading_zeros = LeadingZeros64(mantissa);
+    mantissa <<= leading_zeros;
+
+    //NOTE: the first 64 bits of the power are enough unless every bit below the ones we keep came out set
+    u64* power = f32_powers_of_five + 2 * (exponent - F32_SMALLEST_POWER_OF_TEN);
+    u64 high;
+    u64 low = Multiply64To128(mantissa, power[0], &high);
+    u64 precision_mask = 0xFFFFFFFFFFFFFFFFull >> (F32_MANTISSA_BITS + 3);
+    if ((high & precision_mask) == precision_mask) {
+        u64 second_high;
+        Multiply64To128(mantissa, power[1], &second_high);
+        low += second_high;
+        if (second_high > low) {
+            high++;
+        }
+    }
+
+    u32 upper_bit = (u32)(high >> 63);
+    u32 shift = upper_bit + 64 - F32_MANTISSA_BITS - 3;
+    u64 result = high >> shift;
+    i32 power2 = (i32)((((152170 + 65536) * exponent) >> 16) + 63) + upper_bit - leading_zeros - F32_MINIMUM_EXPONENT;
+    if (power2 <= 0) {
+        if (-power2 + 1 >= 64) {
+            return 0;
+        }
+        result >>= -power2 + 1;
+        result += result & 1;
+        result >>= 1;
+        power2 = result < (1ull << F32_MANTISSA_BITS) ? 0 : 1;
+        return (u32)(power2 << F32_MANTISSA_BITS) | (u32)(result & ((1ull << F32_MANTISSA_BITS) - 1));
+    }
+    //NOTE: exactly halfway rounds to even, which only happens when the product was exact
+    if (low <= 1 && exponent >= -17 && exponent <= 10 && (result & 3) == 1 && (result << shift) == high) {
+        result &= ~1ull;
+    }
+    result += result & 1;
+    result >>= 1;
+    if (result >= (2ull << F32_MANTISSA_BITS)) {
+        result = 1ull << F32_MANTISSA_BITS;
+        power2++;
+    }
+    if (power2 >= F32_INFINITE_POWER) {
+        return F32_INFINITE_POWER << F32_MANTISSA_BITS;
+    }
+    return ((u32)power2 << F32_MANTISSA_BITS) | (u32)(result & ((1ull << F32_MANTISSA_BITS) - 1));
+}
+
+#define BIG_LIMBS 16
+#define BIG_MAX_DIGITS 160
+
+//NOTE: little-endian 32 bit limbs, big enough for any f32 halfway point times a power of 5
+struct BigInteger {
+    u32 limbs[BIG_LIMBS];
+    u32 count;
+};
+
+static void BigMultiply(BigInteger* big, u32 factor) {
+    u64 carry = 0;
+    for (u32 i = 0; i < big->count; i++) {
+        u64 product = (u64)big->limbs[i] * factor + carry;
+        big->limbs[i] = (u32)product;
+        carry = product >> 32;
+    }
+    if (carry) {
+        DASSERT(big->count < BIG_LIMBS);
+        big->limbs[big->count++] = (u32)carry;
+    }
+}
+
+//NOTE: writes the decimal digits most significant first, returns how many
+static u32 BigToDigits(BigInteger* big, u8* digits) {
+    u32 chunks[BIG_MAX_DIGITS / 9 + 1];
+    u32 chunk_count = 0;
+    while (big->count) {
+        u64 remainder = 0;
+        for (u32 i = big->count; i-- > 0;) {
+            u64 current = (remainder << 32) | big->limbs[i];
+            big->limbs[i] = (u32)(current / 1000000000);
+            remainder = current % 1000000000;
+        }
+        chunks[chunk_count++] = (u32)remainder;
+        while (big->count && big->limbs[big->count - 1] == 0) {
+            big->count--;
+        }
+    }
+    u32 length = 0;
+    for (u32 c = chunk_count; c-- > 0;) {
+        u8 chunk_digits[9];
+        u32 chunk = chunks[c];
+        for (u32 d = 9; d-- > 0;) {
+            chunk_digits[d] = (u8)('0' + chunk % 10);
+            chunk /= 10;
+        }
+        for (u32 d = 0; d < 9; d++) {
+            if (length || chunk_digits[d] != '0') {
+                digits[length++] = chunk_digits[d];
+            }
+        }
+    }
+    return length;
+}
+
+//NOTE: sign of number - (odd * 2^power2). Both are compared as 0.digits * 10^position.
+static i32 CompareDecimalToHalfway(DecimalNumber* number, u64 odd, i32 power2) {
+    BigInteger big = {};
+    big.limbs[0] = (u32)odd;
+    big.limbs[1] = (u32)(odd >> 32);
+    big.count = big.limbs[1] ? 2 : 1;
+    i64 decimal_exponent = 0;
+    if (power2 >= 0) {
+        for (i32 i = 0; i < power2; i++) {
+            BigMultiply(&big, 2);
+        }
+    } else {
+        for (i32 i = 0; i < -power2; i++) {
+            BigMultiply(&big, 5);
+        }
+        decimal_exponent = power2;
+    }
+    u8 halfway[BIG_MAX_DIGITS];
+    u32 halfway_length = BigToDigits(&big, halfway);
+    i64 halfway_position = halfway_length + decimal_exponent;
+
+    i64 position = number->written_exponent;
+    u32 digit_index = 0;
+    b8 leading = true;
+    u32 leading_fraction_zeros = 0;
+    for (u32 part = 0; part < 2; part++) {
+        u8* digits = part == 0 ? number->integer : number->fraction;
+        u32 count = part == 0 ? number->integer_length : number->fraction_length;
+        for (u32 d = 0; d < count; d++) {
+            u8 digit = digits[d];
+            if (leading) {
+                if (digit == '0') {
+                    leading_fraction_zeros += part;
+                    continue;
+                }
+                leading = false;
+                position += part == 0 ? number->integer_length - d : -(i64)leading_fraction_zeros;
+                if (position != halfway_position) {
+                    return position > halfway_position ? 1 : -1;
+                }
+            }
+            u8 other = digit_index < halfway_length ? halfway[digit_index] : '0';
+            digit_index++;
+            if (digit != other) {
+                return digit > other ? 1 : -1;
+            }
+        }
+    }
+    for (; digit_index < halfway_length; digit_index++) {
+        if (halfway[digit_index] != '0') {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+//NOTE: pick between the two floats the truncated mantissa's neighbours rounded to
+static u32 ResolveTruncatedF32(DecimalNumber* number, u32 lower) {
+    u32 biased = lower >> F32_MANTISSA_BITS;
+    u64 significand = lower & ((1u << F32_MANTISSA_BITS) - 1);
+    i32 power2 = -149;
+    if (biased) {
+        significand |= 1u << F32_MANTISSA_BITS;
+        power2 = (i32)biased - 150;
+    }
+    i32 compare = CompareDecimalToHalfway(number, significand * 2 + 1, power2 - 1);
+    if (compare == 0) {
+        return (lower & 1) ? lower + 1 : lower;
+    }
+    return compare > 0 ? lower + 1 : lower;
+}
+
+static f32 exact_powers_of_ten_f32[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+
+//NOTE: out of range is anything that rounds to infinity, or a nonzero number that rounds to zero. result then
+//holds the infinity or the zero. Invalid text gives 0.
+static ParseNumberResult ParseF32(u8* str, u32 length, f32* result) {
+    DecimalNumber number;
+    if (!ScanDecimal(str, length, &number)) {
+        *result = 0;
+        return PARSE_NUMBER_INVALID;
+    }
+    f32 value;
+    if (!number.truncated && number.mantissa <= (1ull << 24) && number.exponent >= -10 && number.exponent <= 10) {
+        //NOTE: both operands are exact floats so the one rounding the multiply or divide does is the right one
+        value = (f32)number.mantissa;
+        value = number.exponent < 0 ? value / exact_powers_of_ten_f32[-number.exponent] : value * exact_powers_of_ten_f32[number.exponent];
+    } else {
+        u32 bits = 0;
+        if (number.mantissa) {
+            bits = EiselLemireF32(number.mantissa, number.exponent);
+            if (number.truncated && bits != EiselLemireF32(number.mantissa + 1, number.exponent)) {
+                bits = ResolveTruncatedF32(&number, bits);
+            }
+        }
+        memcpy(&value, &bits, sizeof(value));
+    }
+    *result = number.negative ? -value : value;
+    b8 underflow = value == 0.0f && (number.mantissa || number.truncated);
+    return value == INFINITY || underflow ? PARSE_NUMBER_OUT_OF_RANGE : PARSE_NUMBER_OK;
+}
+
+//NOTE: out of range saturates result to the nearest end of i64, invalid text gives 0
+static ParseNumberResult ParseI64(u8* str, u32 length, i64* result) {
+    u32 i = 0;
+    b8 negative = i < length && str[i] == '-';
+    if (negative) {
+        i++;
+    }
+    *result = 0;
+    if (i == length) {
+        return PARSE_NUMBER_INVALID;
+    }
+    u64 value = 0;
+    b8 overflow = false;
+    for (; i < length; i++) {
+        u32 digit = str[i] - '0';
+        if (digit > 9) {
+            return PARSE_NUMBER_INVALID;
+        }
+        if (value > (0xFFFFFFFFFFFFFFFFull - digit) / 10) {
+            overflow = true;
+        }
+        value = value * 10 + digit;
+    }
+    u64 limit = negative ? (u64)INT64_MAX + 1 : (u64)INT64_MAX;
+    if (overflow || value > limit) {
+        *result = negative ? INT64_MIN : INT64_MAX;
+        return PARSE_NUMBER_OUT_OF_RANGE;
+    }
+    *result = negative ? (i64)(0 - value) : (i64)value;
+    return PARSE_NUMBER_OK;
+}
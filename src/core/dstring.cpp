@@ -1,13 +1,227 @@
+#include "dstring.h"
+//NOTE: SSE2 is part of every x86-64 target. Anywhere else the scans fall back to a byte at a time.
+#if DARCH_X86
+    #include <emmintrin.h>
+    #define DSTRING_SSE2 1
+#else
+    #define DSTRING_SSE2 0
+#endif
+#if DSTRING_SSE2 && defined(__AVX2__)
+    #include <immintrin.h>
+    #define DSTRING_AVX2 1
+#else
+    #define DSTRING_AVX2 0
+#endif
 
+//NOTE: memory is protected in whole pages of at least this size, so a load that stays inside one can't
+//fault even when it reads past the end of a string. Aligned loads never straddle one.
+#define STRING_SCAN_PAGE 4096
+
+inline u32 LowestSetBit(u32 mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+#if DSTRING_SSE2
+inline b32 CanLoad16(u8* str) {
+    return ((u64)str & (STRING_SCAN_PAGE - 1)) <= STRING_SCAN_PAGE - 16;
+}
+
+inline __m128i ToLower16(__m128i bytes) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+    return _mm_add_epi8(bytes, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+}
+#endif
+
+inline u8 ToLower(u8 c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+//NOTE: counts the terminator. Scans in aligned blocks, the bytes of the first block before str are masked off.
 u32 StringLength(u8* str) {
+#if DSTRING_SSE2
+    __m128i zero = _mm_setzero_si128();
+    u8* block = (u8*)((u64)str & ~(u64)15);
+    u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((__m128i*)block), zero)) >> (str - block);
+    if (mask) {
+        return LowestSetBit(mask) + 1;
+    }
+    block += 16;
+#if DSTRING_AVX2
+    if ((u64)block & 31) {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((__m128i*)block), zero));
+        if (mask) {
+            return (u32)(block - str) + LowestSetBit(mask) + 1;
+        }
+        block += 16;
+    }
+    __m256i zero32 = _mm256_setzero_si256();
+    for (;; block += 32) {
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((__m256i*)block), zero32));
+        if (mask) {
+            return (u32)(block - str) + LowestSetBit(mask) + 1;
+        }
+    }
+#else
+    for (;; block += 16) {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((__m128i*)block), zero));
+        if (mask) {
+            return (u32)(block - str) + LowestSetBit(mask) + 1;
+        }
+    }
+#endif
+#else
     u32 result = 0;
-
-    while (*str) {
+    while (str[result]) {
         result++;
-        str++;
     }
-    result++;
-    return result;
+    return result + 1;
+#endif
+}
+
+//NOTE: length-bounded, never reads outside [a, a + length) or [b, b + length)
+static b8 MemEqual(u8* a, u8* b, u32 length) {
+    if (length < 16) {
+        if (length >= 8) {
+            u64 a0, a1, b0, b1;
+            memcpy(&a0, a, 8); memcpy(&a1, a + length - 8, 8);
+            memcpy(&b0, b, 8); memcpy(&b1, b + length - 8, 8);
+            return ((a0 ^ b0) | (a1 ^ b1)) == 0;
+        }
+        if (length >= 4) {
+            u32 a0, a1, b0, b1;
+            memcpy(&a0, a, 4); memcpy(&a1, a + length - 4, 4);
+            memcpy(&b0, b, 4); memcpy(&b1, b + length - 4, 4);
+            return ((a0 ^ b0) | (a1 ^ b1)) == 0;
+        }
+        for (u32 i = 0; i < length; i++) {
+            if (a[i] != b[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+#if DSTRING_SSE2
+    u32 i = 0;
+#if DSTRING_AVX2
+    for (; i + 32 <= length; i += 32) {
+        __m256i equal = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(a + i)), _mm256_loadu_si256((__m256i*)(b + i)));
+        if ((u32)_mm256_movemask_epi8(equal) != 0xFFFFFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i + 16 <= length; i += 16) {
+        __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(a + i)), _mm_loadu_si128((__m128i*)(b + i)));
+        if (_mm_movemask_epi8(equal) != 0xFFFF) {
+            return false;
+        }
+    }
+    if (i < length) {
+        //NOTE: the tail is the last 16 bytes, overlapping what was already compared
+        __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(a + length - 16)), _mm_loadu_si128((__m128i*)(b + length - 16)));
+        return _mm_movemask_epi8(equal) == 0xFFFF;
+    }
+    return true;
+#else
+    return memcmp(a, b, length) == 0;
+#endif
+}
+
+//NOTE: ASCII case-insensitive
+static b8 MemEquali(u8* a, u8* b, u32 length) {
+    if (!DSTRING_SSE2 || length < 16) {
+        for (u32 i = 0; i < length; i++) {
+            if (ToLower(a[i]) != ToLower(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+#if DSTRING_SSE2
+    u32 i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i equal = _mm_cmpeq_epi8(ToLower16(_mm_loadu_si128((__m128i*)(a + i))), ToLower16(_mm_loadu_si128((__m128i*)(b + i))));
+        if (_mm_movemask_epi8(equal) != 0xFFFF) {
+            return false;
+        }
+    }
+    if (i < length) {
+        __m128i equal = _mm_cmpeq_epi8(ToLower16(_mm_loadu_si128((__m128i*)(a + length - 16))), ToLower16(_mm_loadu_si128((__m128i*)(b + length - 16))));
+        return _mm_movemask_epi8(equal) == 0xFFFF;
+    }
+#endif
+    return true;
+}
+
+//NOTE: index of the first byte in [data, data + length) equal to byte, -1 if there isn't one
+static i32 MemFindByte(u8* data, u32 length, u8 byte) {
+    u32 i = 0;
+#if DSTRING_AVX2
+    __m256i needle32 = _mm256_set1_epi8((char)byte);
+    for (; i + 32 <= length; i += 32) {
+        u32 mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(data + i)), needle32));
+        if (mask) {
+            return i + LowestSetBit(mask);
+        }
+    }
+#endif
+#if DSTRING_SSE2
+    __m128i needle = _mm_set1_epi8((char)byte);
+    for (; i + 16 <= length; i += 16) {
+        u32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(data + i)), needle));
+        if (mask) {
+            return i + LowestSetBit(mask);
+        }
+    }
+    if (i < length && length >= 16) {
+        u32 start = length - 16;
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(data + start)), needle)) >> (i - start);
+        return mask ? i + LowestSetBit(mask) : -1;
+    }
+#endif
+    for (; i < length; i++) {
+        if (data[i] == byte) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//NOTE: first byte in a NUL terminated string, 0 if the string ends first. The terminator isn't part
+//of the string, so looking for 0 finds nothing.
+static u8* StringFindByte(u8* str, u8 byte) {
+    if (byte == 0) {
+        return 0;
+    }
+#if DSTRING_SSE2
+    __m128i zero = _mm_setzero_si128();
+    __m128i needle = _mm_set1_epi8((char)byte);
+    u8* block = (u8*)((u64)str & ~(u64)15);
+    u32 skip = (u32)(str - block);
+    for (;; block += 16) {
+        __m128i bytes = _mm_load_si128((__m128i*)block);
+        u32 ends = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)) >> skip << skip;
+        u32 found = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, needle)) >> skip << skip;
+        skip = 0;
+        if (ends | found) {
+            u32 first = LowestSetBit(ends | found);
+            return (found >> first) & 1 ? block + first : 0;
+        }
+    }
+#else
+    for (; *str; str++) {
+        if (*str == byte) {
+            return str;
+        }
+    }
+    return 0;
+#endif
 }
 
 static b8 StringsEqual(u8* str1, u8* str2) {
@@ -15,34 +229,111 @@ static b8 StringsEqual(u8* str1, u8* str2) {
         DERROR("StringsEqual - Null string passed.");
         return false;
     }
-    while ((*str1 && *str2) && (*str1 == *str2)) {
+#if DSTRING_SSE2
+    __m128i zero = _mm_setzero_si128();
+#endif
+    for (;;) {
+#if DSTRING_SSE2
+        //NOTE: 16 at a time while neither load can reach into the next page, a byte at a time across the boundary
+        while (CanLoad16(str1) && CanLoad16(str2)) {
+            __m128i a = _mm_loadu_si128((__m128i*)str1);
+            __m128i b = _mm_loadu_si128((__m128i*)str2);
+            u32 ends = _mm_movemask_epi8(_mm_cmpeq_epi8(a, zero));
+            u32 diffs = ~_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+            if (ends | diffs) {
+                return ((diffs >> LowestSetBit(ends | diffs)) & 1) == 0;
+            }
+            str1 += 16;
+            str2 += 16;
+        }
+#endif
+        if (*str1 != *str2) {
+            return false;
+        }
+        if (*str1 == '\0') {
+            return true;
+        }
         str1++;
         str2++;
     }
-    return (*str1 == '\0' && *str2 == '\0');
 }
 
 static b8 StringsEquali(char* str1, char* str2) {
     if (!str1 || !str2) {
         DERROR("StringsEquali - Null string passed.")
+        return false;
     }
-    u32 lowercase_offset = 'a' - 'A';
-    while (*str1 && *str2) {
-        char char1 = *str1;
-        char char2 = *str2;
-        if (char1 >= 'A' && char1 <= 'Z') {
-            char1 += lowercase_offset;
+    u8* a_str = (u8*)str1;
+    u8* b_str = (u8*)str2;
+#if DSTRING_SSE2
+    __m128i zero = _mm_setzero_si128();
+#endif
+    for (;;) {
+#if DSTRING_SSE2
+        while (CanLoad16(a_str) && CanLoad16(b_str)) {
+            __m128i a = ToLower16(_mm_loadu_si128((__m128i*)a_str));
+            __m128i b = ToLower16(_mm_loadu_si128((__m128i*)b_str));
+            u32 ends = _mm_movemask_epi8(_mm_cmpeq_epi8(a, zero));
+            u32 diffs = ~_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) & 0xFFFF;
+            if (ends | diffs) {
+                return ((diffs >> LowestSetBit(ends | diffs)) & 1) == 0;
+            }
+            a_str += 16;
+            b_str += 16;
         }
-        if (char2 >= 'A' && char2 <= 'Z') {
-            char2 += lowercase_offset;
+#endif
+        if (ToLower(*a_str) != ToLower(*b_str)) {
+            return false;
         }
-        if (char1 != char2) {
-            break;
+        if (*a_str == '\0') {
+            return true;
         }
-        str1++;
-        str2++;
+        a_str++;
+        b_str++;
     }
-    return (*str1 == '\0' && *str2 == '\0');
+}
+
+//NOTE: lengths don't include a terminator, neither string has to have one
+static b8 StringsEqualN(u8* str1, u32 length1, u8* str2, u32 length2) {
+    return length1 == length2 && MemEqual(str1, str2, length1);
+}
+
+static b8 StringsEqualiN(u8* str1, u32 length1, u8* str2, u32 length2) {
+    return length1 == length2 && MemEquali(str1, str2, length1);
+}
+
+inline String Str(u8* data, u32 length) {
+    return {data, length};
+}
+
+inline String StringFromC(u8* str) {
+    return {str, StringLength(str) - 1};
+}
+
+inline String StringFromC(char* str) {
+    return StringFromC((u8*)str);
+}
+
+static b8 StringsEqual(String str1, String str2) {
+    return StringsEqualN(str1.data, str1.length, str2.data, str2.length);
+}
+
+static b8 StringsEquali(String str1, String str2) {
+    return StringsEqualiN(str1.data, str1.length, str2.data, str2.length);
+}
+
+inline String SubString(String str, u32 start, u32 count) {
+    DASSERT(start + count <= str.length);
+    return {str.data + start, count};
+}
+
+//NOTE: index of the first byte equal to byte, -1 if there isn't one
+inline i32 StringFind(String str, u8 byte) {
+    return MemFindByte(str.data, str.length, byte);
+}
+
+inline u32 StringHash(String str) {
+    return HashBytes(str.data, str.length);
 }
 
 inline b32 IsEndOfLine(char c) {
@@ -112,10 +403,4 @@ inline i32 GetLine(u8* src, u8* dest) {
         bytes_read++;
     }
     return bytes_read;
-}
-
-#include <stdlib.h>
-inline f32 StringToF32(u8* str) {
-    return atof((char*)str);
-}
-//TODO: make string compare that takes lengths
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+//NOTE: length bytes at data. Nothing says data is NUL terminated, so a String can point straight into
+//source text or a table slot. Text from outside (C literals, file names) is measured once with
+//StringFromC and carried as a String from then on.
+struct String {
+    u8* data;
+    u32 length;
+};
+
+#define StringLiteral(text) String{(u8*)(text), sizeof(text) - 1}
@@ -1,9 +1,39 @@
 #include "logger.h"
+#include "defines.h"
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#if DPLATFORM_WINDOWS
 #include <windows.h>
-#include "defines.h"
+#else
+#include <unistd.h>
+#endif
+#include <thread>
+#include <mutex>
+
+#define LOG_RECORD_SIZE 1024
+#define LOG_QUEUE_SIZE 1024
+#define LOG_WRITER_BATCH 16
+
+struct LogRecord {
+    LogLevel level;
+    char text[LOG_RECORD_SIZE];
+};
+
+struct LogWriter {
+    MpmcRing<LogRecord> records;
+    std::thread thread;
+    std::atomic<b32> running;
+};
+
+static LogWriter log_writer;
+static std::atomic<b32> log_writer_started{false};
+//NOTE: threads inside QueueLogMessage, StopLogWriter waits for them so no record lands in the ring
+//after the writer has drained it for the last time
+static std::atomic<u32> log_writer_producers{0};
+//NOTE: held while records are popped and written, so a message written straight from its thread can
+//first write out everything queued ahead of it
+static std::mutex log_write_lock;
 
 //b8 InitializeLogging(u64* memoryRequirement, void* state){
 //    *memoryRequirement = sizeof(LoggerSystemState);
@@ -28,6 +58,7 @@
 //    //TODO: cleanup logging/write queued entries
 //}
 
+#if DPLATFORM_WINDOWS
 void Win32ConsoleWrite(char* message, u8 color) {
     HANDLE console_handle = GetStdHandle(STD_OUTPUT_HANDLE);
     //fatal, error, info, debug, trace
@@ -51,6 +82,23 @@ void Win32ConsoleWriteError(char* message, u8 color) {
     LPDWORD numberWritten = 0;
     WriteConsoleA(GetStdHandle(STD_ERROR_HANDLE), message, (DWORD)length, numberWritten, 0);
 }
+#else
+//NOTE: the same colors the Win32 versions set, as ANSI escapes. Left out when fd isn't a terminal so
+//redirected logs stay plain text.
+void PosixConsoleWrite(i32 fd, char* message, u8 color) {
+    //fatal, error, warn, info, debug, trace
+    const char* levels[6] = {"\x1b[41m", "\x1b[31m", "\x1b[33m", "\x1b[32m", "\x1b[34m", "\x1b[90m"};
+    const char* reset = "\x1b[0m";
+    b32 colored = isatty(fd);
+    if (colored) {
+        write(fd, levels[color], strlen(levels[color]));
+    }
+    write(fd, message, strlen(message));
+    if (colored) {
+        write(fd, reset, strlen(reset));
+    }
+}
+#endif
 
 i32 StringFormatV(char* dest, char* format, va_list va_listp) {
     if (dest) {
@@ -76,10 +124,98 @@ i32 StringFormat(char* dest, char* format, ...) {
     return -1;
 }
 
+static void WriteLogMessage(LogLevel level, char* message) {
+#if DPLATFORM_WINDOWS
+    if (level < LOG_LEVEL_WARN) {
+        Win32ConsoleWriteError(message, level);
+    } else {
+        Win32ConsoleWrite(message, level);
+    }
+#else
+    PosixConsoleWrite(level < LOG_LEVEL_WARN ? STDERR_FILENO : STDOUT_FILENO, message, level);
+#endif
+}
+
+//NOTE: call with log_write_lock held
+static u32 WriteQueuedLogMessages(LogRecord* batch) {
+    if (!log_writer.records.slots) {
+        return 0;
+    }
+    u32 count = MpmcRingPopBatch(&log_writer.records, batch, LOG_WRITER_BATCH);
+    for (u32 i = 0; i < count; i++) {
+        WriteLogMessage(batch[i].level, batch[i].text);
+    }
+    return count;
+}
+
+//NOTE: for messages that can't be queued, keeps them in order with the ones that were
+static void WriteLogMessageInOrder(LogLevel level, char* message) {
+    LogRecord batch[LOG_WRITER_BATCH];
+    std::lock_guard<std::mutex> lock(log_write_lock);
+    while (WriteQueuedLogMessages(batch)) {
+    }
+    WriteLogMessage(level, message);
+}
+
+static void LogWriterRun() {
+    LogRecord batch[LOG_WRITER_BATCH];
+    for (;;) {
+        //NOTE: read running before popping so nothing pushed before StopLogWriter gets left behind
+        b32 running = log_writer.running.load(std::memory_order_acquire);
+        u32 count;
+        {
+            std::lock_guard<std::mutex> lock(log_write_lock);
+            count = WriteQueuedLogMessages(batch);
+        }
+        if (count == 0) {
+            if (!running) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void StartLogWriter(MemoryArena* arena) {
+    DASSERT(!log_writer_started.load());
+    MpmcRingInit(arena, &log_writer.records, LOG_QUEUE_SIZE);
+    log_writer.running.store(true);
+    log_writer.thread = std::thread(LogWriterRun);
+    log_writer_started.store(true, std::memory_order_release);
+}
+
+//NOTE: writes out everything still queued before returning. Producers that already saw the writer
+//running finish their push first, later ones write their messages themselves.
+void StopLogWriter() {
+    if (!log_writer_started.load()) {
+        return;
+    }
+    log_writer_started.store(false);
+    while (log_writer_producers.load() != 0) {
+        std::this_thread::yield();
+    }
+    log_writer.running.store(false, std::memory_order_release);
+    log_writer.thread.join();
+}
+
+static b32 QueueLogMessage(LogLevel level, char* message, i32 length) {
+    if (level == LOG_LEVEL_FATAL || length >= LOG_RECORD_SIZE) {
+        return false;
+    }
+    log_writer_producers.fetch_add(1);
+    b32 queued = false;
+    if (log_writer_started.load()) {
+        LogRecord record;
+        record.level = level;
+        memcpy(record.text, message, length + 1);
+        queued = MpmcRingPush(&log_writer.records, record);
+    }
+    log_writer_producers.fetch_sub(1);
+    return queued;
+}
+
 void LogOutput(LogLevel level, b8 insert_newline, char* message, ...) {
-    //TODO: all this stuff has to go on another thread since it's so slow
     const char* level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]: ", "[INFO]: ", "[DEBUG]: ", "[TRACE]: "};
-    b8 is_error = level < LOG_LEVEL_WARN;
 
     char out_message[32000] = {};
 
@@ -89,18 +225,16 @@ void LogOutput(LogLevel level, b8 insert_newline, char* message, ...) {
     StringFormatV(out_message, message, arg_ptr);
     va_end(arg_ptr);
 
+    i32 length;
     if (insert_newline) {
-        StringFormat(out_message, "%s%s\n", level_strings[level], out_message);
+        length = StringFormat(out_message, "%s%s\n", level_strings[level], out_message);
     } else {
-        StringFormat(out_message, "%s", out_message);
+        length = StringFormat(out_message, "%s", out_message);
     }
 
-    if (is_error) {
-        Win32ConsoleWriteError(out_message, level);
-    } else{
-        Win32ConsoleWrite(out_message, level);
+    if (!QueueLogMessage(level, out_message, length)) {
+        WriteLogMessageInOrder(level, out_message);
     }
-
 }
 
 void ReportAssertionFailure(char* expression, char* message, char* file, i32 line){
@@ -24,7 +24,14 @@ b8 InitializeLogging(u64* memoryRequirement, void* state);
 
 void ShutdownLogging(void* state);
 
- void LogOutput(LogLevel level, char* message, b8 insert_newline, ...);
+struct MemoryArena;
+//NOTE: once started, LogOutput hands messages to a writer thread instead of writing them itself.
+//Fatal messages and ones that don't fit in a record or the queue are still written on the calling thread,
+//after whatever was queued ahead of them.
+void StartLogWriter(MemoryArena* arena);
+void StopLogWriter();
+
+void LogOutput(LogLevel level, b8 insert_newline, char* message, ...);
 
 #define DFATAL(message, ...) LogOutput(LOG_LEVEL_FATAL, true, message, ##__VA_ARGS__);
 #define DFATALN(message, ...) LogOutput(LOG_LEVEL_FATAL, false, message, ##__VA_ARGS__);
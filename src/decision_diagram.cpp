@@ -0,0 +1,505 @@
+#include "decision_diagram.h"
+
+//NOTE: every distinct condition the rule set tests, and the constants it is compared against.
+//Values nobody tests against all behave the same, so they share the node's default branch.
+struct DecisionCondition {
+	ConditionRef condition;
+	u32 first_value;
+	u32 value_count;
+};
+
+struct DecisionTest {
+	ConditionTest* test;
+	u32 rule;
+	u32 condition;
+};
+
+struct DecisionMemoEntry {
+	u32 hash;
+	u8* state;
+	u32 result;
+};
+
+//NOTE: a build state is one byte per rule (still alive) followed by one byte per test (still pending)
+struct DecisionBuilder {
+	DecisionDiagram* dd;
+	MemoryArena* scratch;
+	MemoryArena memo_memory;
+
+	RuleConditions* rules;
+	u32 rule_count;
+
+	DecisionTest* tests;
+	u32 test_count;
+
+	DecisionCondition* conditions;
+	u32 condition_count;
+	Value* domain;
+	u32 domain_count;
+
+	u32* node_lookup;
+	u32* leaf_lookup;
+	u32 lookup_capacity;
+
+	DecisionMemoEntry* memo;
+	u32 memo_capacity;
+	u32 memo_count;
+};
+
+void DecisionDiagramInit(DecisionDiagram* dd, MemoryArena* arena, u32 max_nodes, u32 max_branches, u32 max_leaves, u32 max_leaf_rules) {
+	dd->root = DECISION_LEAF_BIT;
+	dd->nodes = PushArray(arena, max_nodes, DecisionNode);
+	dd->node_count = 0;
+	dd->node_capacity = max_nodes;
+	dd->branches = PushArray(arena, max_branches, DecisionBranch);
+	dd->branch_count = 0;
+	dd->branch_capacity = max_branches;
+	dd->leaves = PushArray(arena, max_leaves, DecisionLeaf);
+	dd->leaf_count = 0;
+	dd->leaf_capacity = max_leaves;
+	dd->leaf_rules = PushArray(arena, max_leaf_rules, RuleId);
+	dd->leaf_rule_count = 0;
+	dd->leaf_rule_capacity = max_leaf_rules;
+}
+
+//NOTE: value == 0 is the "matches none of the tested constants" branch
+static b8 DecisionTestPasses(ConditionTest* test, Value* value) {
+	if (!value) {
+		return test->op == TEST_NOT_EQUAL;
+	}
+	return EvaluateConditionTest(test, *value);
+}
+
+static void DecisionCollectConditions(DecisionBuilder* builder) {
+	u32 total_tests = 0;
+	for (u32 rule = 0; rule < builder->rule_count; rule++) {
+		total_tests += builder->rules[rule].test_count;
+	}
+	builder->tests = PushArray(builder->scratch, total_tests, DecisionTest);
+	builder->test_count = 0;
+	builder->conditions = PushArray(builder->scratch, total_tests, DecisionCondition);
+	builder->condition_count = 0;
+	builder->domain = PushArray(builder->scratch, total_tests, Value);
+	builder->domain_count = 0;
+
+	//NOTE: domain values for one condition must be contiguous, so gather condition by condition
+	for (u32 rule = 0; rule < builder->rule_count; rule++) {
+		RuleConditions* conditions = builder->rules + rule;
+		for (u32 i = 0; i < conditions->test_count; i++) {
+			ConditionTest* test = conditions->tests + i;
+			DASSERT_MSG(test->op == TEST_EQUAL || test->op == TEST_NOT_EQUAL, "Decision diagrams only compile equality tests over enumerated values");
+			u32 condition = 0;
+			for (; condition < builder->condition_count; condition++) {
+				if (ConditionRefsEqual(builder->conditions[condition].condition, test->condition)) {
+					break;
+				}
+			}
+			if (condition == builder->condition_count) {
+				builder->conditions[condition].condition = test->condition;
+				builder->condition_count++;
+			}
+			builder->tests[builder->test_count++] = {test, rule, condition};
+		}
+	}
+	for (u32 condition = 0; condition < builder->condition_count; condition++) {
+		DecisionCondition* entry = builder->conditions + condition;
+		entry->first_value = builder->domain_count;
+		entry->value_count = 0;
+		for (u32 i = 0; i < builder->test_count; i++) {
+			if (builder->tests[i].condition != condition) {
+				continue;
+			}
+			Value constant = builder->tests[i].test->constant;
+			b8 seen = false;
+			for (u32 v = 0; v < entry->value_count; v++) {
+				if (ValuesEqual(builder->domain[entry->first_value + v], constant)) {
+					seen = true;
+					break;
+				}
+			}
+			if (!seen) {
+				builder->domain[builder->domain_count++] = constant;
+				entry->value_count++;
+			}
+		}
+	}
+}
+
+static u32 DecisionMakeLeaf(DecisionBuilder* builder, u8* state) {
+	DecisionDiagram* dd = builder->dd;
+	u32 hash = 0;
+	u32 rule_count = 0;
+	for (u32 rule = 0; rule < builder->rule_count; rule++) {
+		if (state[rule]) {
+			hash = HashBytes(&rule, sizeof(rule), hash);
+			rule_count++;
+		}
+	}
+	u32 mask = builder->lookup_capacity - 1;
+	u32 slot = hash & mask;
+	for (; builder->leaf_lookup[slot] != INVALID_ID; slot = (slot + 1) & mask) {
+		DecisionLeaf* leaf = dd->leaves + builder->leaf_lookup[slot];
+		if (leaf->rule_count != rule_count) {
+			continue;
+		}
+		u32 matched = 0;
+		for (u32 rule = 0; rule < builder->rule_count; rule++) {
+			if (state[rule] && dd->leaf_rules[leaf->first_rule + matched] == builder->rules[rule].rule) {
+				matched++;
+			} else if (state[rule]) {
+				break;
+			}
+		}
+		if (matched == rule_count) {
+			return builder->leaf_lookup[slot] | DECISION_LEAF_BIT;
+		}
+	}
+
+	DASSERT(dd->leaf_count < dd->leaf_capacity);
+	DASSERT(dd->leaf_rule_count + rule_count <= dd->leaf_rule_capacity);
+	u32 index = dd->leaf_count++;
+	DecisionLeaf* leaf = dd->leaves + index;
+	leaf->first_rule = dd->leaf_rule_count;
+	leaf->rule_count = rule_count;
+	for (u32 rule = 0; rule < builder->rule_count; rule++) {
+		if (state[rule]) {
+			dd->leaf_rules[dd->leaf_rule_count++] = builder->rules[rule].rule;
+		}
+	}
+	builder->leaf_lookup[slot] = index;
+	return index | DECISION_LEAF_BIT;
+}
+
+//NOTE: hash-consing nodes is what turns the decision tree into a reduced DAG
+static u32 DecisionMakeNode(DecisionBuilder* builder, u32 condition, u32* children, u32 default_child) {
+	DecisionDiagram* dd = builder->dd;
+	DecisionCondition* entry = builder->conditions + condition;
+	u32 hash = HashBytes(&condition, sizeof(condition));
+	hash = HashBytes(&default_child, sizeof(default_child), hash);
+	u32 branch_count = 0;
+	for (u32 v = 0; v < entry->value_count; v++) {
+		if (children[v] != default_child) {
+			hash = HashBytes(&v, sizeof(v), hash);
+			hash = HashBytes(children + v, sizeof(u32), hash);
+			branch_count++;
+		}
+	}
+
+	u32 mask = builder->lookup_capacity - 1;
+	u32 slot = hash & mask;
+	for (; builder->node_lookup[slot] != INVALID_ID; slot = (slot + 1) & mask) {
+		DecisionNode* node = dd->nodes + builder->node_lookup[slot];
+		if (!ConditionRefsEqual(node->condition, entry->condition) || node->default_child != default_child || node->branch_count != branch_count) {
+			continue;
+		}
+		DecisionBranch* branch = dd->branches + node->first_branch;
+		b8 same = true;
+		for (u32 v = 0; v < entry->value_count && same; v++) {
+			if (children[v] == default_child) {
+				continue;
+			}
+			same = ValuesEqual(branch->value, builder->domain[entry->first_value + v]) && branch->child == children[v];
+			branch++;
+		}
+		if (same) {
+			return builder->node_lookup[slot];
+		}
+	}
+
+	DASSERT(dd->node_count < dd->node_capacity);
+	DASSERT(dd->branch_count + branch_count <= dd->branch_capacity);
+	u32 index = dd->node_count++;
+	DecisionNode* node = dd->nodes + index;
+	node->condition = entry->condition;
+	node->first_branch = dd->branch_count;
+	node->branch_count = branch_count;
+	node->default_child = default_child;
+	for (u32 v = 0; v < entry->value_count; v++) {
+		if (children[v] != default_child) {
+			dd->branches[dd->branch_count++] = {builder->domain[entry->first_value + v], children[v]};
+		}
+	}
+	builder->node_lookup[slot] = index;
+	return index;
+}
+
+//NOTE: branch == value_count is the default branch
+static void DecisionApplyBranch(DecisionBuilder* builder, u8* state, u32 condition, u32 branch) {
+	DecisionCondition* entry = builder->conditions + condition;
+	Value* value = branch < entry->value_count ? builder->domain + entry->first_value + branch : 0;
+	u8* pending = state + builder->rule_count;
+	for (u32 i = 0; i < builder->test_count; i++) {
+		DecisionTest* test = builder->tests + i;
+		if (test->condition != condition || !pending[i] || !state[test->rule]) {
+			continue;
+		}
+		pending[i] = false;
+		if (!DecisionTestPasses(test->test, value)) {
+			state[test->rule] = false;
+		}
+	}
+}
+
+static u32 DecisionUndecidedRules(DecisionBuilder* builder, u8* state) {
+	u8* pending = state + builder->rule_count;
+	u32 result = 0;
+	u32 last_rule = INVALID_ID;
+	for (u32 i = 0; i < builder->test_count; i++) {
+		DecisionTest* test = builder->tests + i;
+		if (pending[i] && state[test->rule] && test->rule != last_rule) {
+			result++;
+			last_rule = test->rule;
+		}
+	}
+	return result;
+}
+
+//NOTE: greedy pick of the condition that leaves the fewest undecided rules on average over its
+//branches. Branches are weighted evenly since we don't know the distribution of condition values.
+static u32 DecisionChooseCondition(DecisionBuilder* builder, u8* state, u32 state_size) {
+	u8* pending = state + builder->rule_count;
+	u8* trial = PushSize(builder->scratch, state_size);
+	u32 best = INVALID_ID;
+	f32 best_cost = F32Max;
+	for (u32 condition = 0; condition < builder->condition_count; condition++) {
+		b8 used = false;
+		for (u32 i = 0; i < builder->test_count && !used; i++) {
+			used = builder->tests[i].condition == condition && pending[i] && state[builder->tests[i].rule];
+		}
+		if (!used) {
+			continue;
+		}
+		u32 branches = builder->conditions[condition].value_count + 1;
+		u32 undecided = 0;
+		for (u32 branch = 0; branch < branches; branch++) {
+			MemCopy(state, trial, state_size);
+			DecisionApplyBranch(builder, trial, condition, branch);
+			undecided += DecisionUndecidedRules(builder, trial);
+		}
+		f32 cost = (f32)undecided / (f32)branches;
+		if (cost < best_cost) {
+			best_cost = cost;
+			best = condition;
+		}
+	}
+	return best;
+}
+
+static u32 DecisionBuild(DecisionBuilder* builder, u8* state) {
+	u32 state_size = builder->rule_count + builder->test_count;
+	u32 hash = HashBytes(state, state_size);
+	u32 mask = builder->memo_capacity - 1;
+	u32 slot = hash & mask;
+	for (; builder->memo[slot].state; slot = (slot + 1) & mask) {
+		DecisionMemoEntry* entry = builder->memo + slot;
+		if (entry->hash == hash && memcmp(entry->state, state, state_size) == 0) {
+			return entry->result;
+		}
+	}
+
+	TempMemory temp = BeginTempMemory(builder->scratch);
+	u32 result;
+	u32 condition = DecisionChooseCondition(builder, state, state_size);
+	if (condition == INVALID_ID) {
+		result = DecisionMakeLeaf(builder, state);
+	} else {
+		DecisionCondition* entry = builder->conditions + condition;
+		u32* children = PushArray(builder->scratch, entry->value_count + 1, u32);
+		u8* child_state = PushSize(builder->scratch, state_size);
+		b8 all_same = true;
+		for (u32 branch = 0; branch <= entry->value_count; branch++) {
+			MemCopy(state, child_state, state_size);
+			DecisionApplyBranch(builder, child_state, condition, branch);
+			children[branch] = DecisionBuild(builder, child_state);
+			all_same = all_same && children[branch] == children[0];
+		}
+		if (all_same) {
+			result = children[0];
+		} else {
+			result = DecisionMakeNode(builder, condition, children, children[entry->value_count]);
+		}
+	}
+	EndTempMemory(temp);
+
+	//NOTE: stop memoizing once the table gets crowded rather than failing the compile
+	if (builder->memo_count < builder->memo_capacity / 4 * 3 && builder->memo_memory.used + state_size <= builder->memo_memory.size) {
+		for (slot = hash & mask; builder->memo[slot].state; slot = (slot + 1) & mask) {}
+		builder->memo[slot] = {hash, PushCopy(&builder->memo_memory, state, state_size, u8), result};
+		builder->memo_count++;
+	}
+	return result;
+}
+
+//NOTE: compiles every rule's tests into one diagram that answers "which rules fire" with a single walk
+//from the root. Meant to run offline, the scratch arena needs room for the memo of visited build states.
+void DecisionDiagramCompile(DecisionDiagram* dd, MemoryArena* scratch, RuleConditions* rules, u32 rule_count) {
+	DecisionBuilder builder = {};
+	builder.dd = dd;
+	builder.scratch = scratch;
+	builder.rules = rules;
+	builder.rule_count = rule_count;
+	DecisionCollectConditions(&builder);
+
+	builder.lookup_capacity = RoundUpPowOf2(Maximum(dd->node_capacity, dd->leaf_capacity) * 2);
+	builder.node_lookup = PushArray(scratch, builder.lookup_capacity, u32);
+	builder.leaf_lookup = PushArray(scratch, builder.lookup_capacity, u32);
+	for (u32 i = 0; i < builder.lookup_capacity; i++) {
+		builder.node_lookup[i] = INVALID_ID;
+		builder.leaf_lookup[i] = INVALID_ID;
+	}
+	builder.memo_capacity = RoundUpPowOf2(dd->node_capacity * 4);
+	builder.memo = PushArray(scratch, builder.memo_capacity, DecisionMemoEntry);
+	memset(builder.memo, 0, builder.memo_capacity * sizeof(DecisionMemoEntry));
+	u64 memo_size = (scratch->size - scratch->used) / 2;
+	InitializeArena(&builder.memo_memory, memo_size, PushSize(scratch, memo_size));
+
+	u32 state_size = rule_count + builder.test_count;
+	u8* state = PushSize(scratch, state_size);
+	memset(state, true, state_size);
+	dd->root = DecisionBuild(&builder, state);
+}
+
+//NOTE: nodes are built after their children, so a node only ever points at lower node indices. Holding a
+//loaded diagram to that means a walk can't loop.
+static b32 DecisionChildValid(DecisionDiagram* dd, u32 child, u32 node_limit) {
+	return (child & DECISION_LEAF_BIT) ? (child & ~DECISION_LEAF_BIT) < dd->leaf_count : child < node_limit;
+}
+
+//NOTE: writes the rules that fire for the current table state into out_rules, returns how many
+u32 DecisionDiagramMatch(DecisionDiagram* dd, ConditionTables* tables, RuleId* out_rules, u32 max_rules) {
+	u32 node_index = dd->root;
+	while (!(node_index & DECISION_LEAF_BIT)) {
+		DecisionNode* node = dd->nodes + node_index;
+		Value value = QueryConditionValue(tables, node->condition);
+		u32 next = node->default_child;
+		DecisionBranch* branch = dd->branches + node->first_branch;
+		for (u32 i = 0; i < node->branch_count; i++, branch++) {
+			if (ValuesEqual(value, branch->value)) {
+				next = branch->child;
+				break;
+			}
+		}
+		node_index = next;
+	}
+	DecisionLeaf* leaf = dd->leaves + (node_index & ~DECISION_LEAF_BIT);
+	u32 count = Minimum(leaf->rule_count, max_rules);
+	MemCopy(dd->leaf_rules + leaf->first_rule, out_rules, count * sizeof(RuleId));
+	return count;
+}
+
+//NOTE: pads the file written so far, which starts at start, out to the next section boundary
+static void DecisionPadSection(MemoryArena* scratch, u8* start) {
+	u64 size = (scratch->base + scratch->used) - start;
+	u64 padding = (DECISION_SECTION_ALIGN - size % DECISION_SECTION_ALIGN) % DECISION_SECTION_ALIGN;
+	memset(PushSize(scratch, padding), 0, padding);
+}
+
+b32 DecisionDiagramWrite(DecisionDiagram* dd, MemoryArena* scratch, char* filename) {
+	TempMemory temp = BeginTempMemory(scratch);
+	DecisionDiagramFileHeader* header = PushStruct(scratch, DecisionDiagramFileHeader);
+	u8* start = (u8*)header;
+	header->magic = DECISION_DIAGRAM_MAGIC;
+	header->root = dd->root;
+	header->node_count = dd->node_count;
+	header->branch_count = dd->branch_count;
+	header->leaf_count = dd->leaf_count;
+	header->leaf_rule_count = dd->leaf_rule_count;
+	DecisionPadSection(scratch, start);
+	PushCopy(scratch, dd->nodes, dd->node_count, DecisionNode);
+	DecisionPadSection(scratch, start);
+	DecisionBranch* branches = PushCopy(scratch, dd->branches, dd->branch_count, DecisionBranch);
+	DecisionPadSection(scratch, start);
+	PushCopy(scratch, dd->leaves, dd->leaf_count, DecisionLeaf);
+	DecisionPadSection(scratch, start);
+	PushCopy(scratch, dd->leaf_rules, dd->leaf_rule_count, RuleId);
+	DecisionPadSection(scratch, start);
+
+	u8* strings = scratch->base + scratch->used;
+	for (u32 i = 0; i < dd->branch_count; i++) {
+		if (IsString(branches[i].value)) {
+			u32 length = AsStringLength(branches[i].value);
+			u64 offset = (scratch->base + scratch->used) - strings;
+			PushCopy(scratch, AsString(branches[i].value), length, u8);
+			*PushSize(scratch, 1) = '\0';
+			branches[i].value.string = (u8*)offset;
+		}
+	}
+	header->string_bytes = (u32)((scratch->base + scratch->used) - strings);
+
+	u32 size = (u32)(scratch->used - temp.used);
+	b32 result = DebugPlatformWriteEntireFile(filename, size, header);
+	EndTempMemory(temp);
+	return result;
+}
+
+//NOTE: steps *at past the section boundary and count elements of size bytes, 0 if they run past end
+static u8* DecisionLoadSection(u8* contents, u8** at, u8* end, u64 count, u64 size) {
+	u64 offset = (u64)(*at - contents);
+	offset = (offset + DECISION_SECTION_ALIGN - 1) / DECISION_SECTION_ALIGN * DECISION_SECTION_ALIGN;
+	if (offset > (u64)(end - contents) || count * size > (u64)(end - contents) - offset) {
+		return 0;
+	}
+	u8* section = contents + offset;
+	*at = section + count * size;
+	return section;
+}
+
+//NOTE: points the diagram at the tables inside a loaded file, the file memory has to outlive it and start
+//on a DECISION_SECTION_ALIGN boundary. Every index and string offset is checked before the diagram is used.
+b32 DecisionDiagramLoad(DecisionDiagram* dd, u8* contents, u32 contents_size) {
+	DecisionDiagramFileHeader* header = (DecisionDiagramFileHeader*)contents;
+	if ((u64)contents % DECISION_SECTION_ALIGN != 0 || contents_size < sizeof(DecisionDiagramFileHeader) ||
+		header->magic != DECISION_DIAGRAM_MAGIC) {
+		return false;
+	}
+	u8* end = contents + contents_size;
+	u8* at = contents + sizeof(DecisionDiagramFileHeader);
+	u8* nodes = DecisionLoadSection(contents, &at, end, header->node_count, sizeof(DecisionNode));
+	u8* branches = nodes ? DecisionLoadSection(contents, &at, end, header->branch_count, sizeof(DecisionBranch)) : 0;
+	u8* leaves = branches ? DecisionLoadSection(contents, &at, end, header->leaf_count, sizeof(DecisionLeaf)) : 0;
+	u8* leaf_rules = leaves ? DecisionLoadSection(contents, &at, end, header->leaf_rule_count, sizeof(RuleId)) : 0;
+	u8* strings = leaf_rules ? DecisionLoadSection(contents, &at, end, header->string_bytes, 1) : 0;
+	if (!strings) {
+		return false;
+	}
+	dd->root = header->root;
+	dd->nodes = (DecisionNode*)nodes;
+	dd->node_count = dd->node_capacity = header->node_count;
+	dd->branches = (DecisionBranch*)branches;
+	dd->branch_count = dd->branch_capacity = header->branch_count;
+	dd->leaves = (DecisionLeaf*)leaves;
+	dd->leaf_count = dd->leaf_capacity = header->leaf_count;
+	dd->leaf_rules = (RuleId*)leaf_rules;
+	dd->leaf_rule_count = dd->leaf_rule_capacity = header->leaf_rule_count;
+
+	for (u32 i = 0; i < dd->branch_count; i++) {
+		DecisionBranch* branch = dd->branches + i;
+		if (IsString(branch->value)) {
+			u64 offset = (u64)branch->value.string;
+			u64 length = AsStringLength(branch->value);
+			if (offset >= header->string_bytes || length >= header->string_bytes - offset || strings[offset + length] != '\0') {
+				return false;
+			}
+			branch->value.string = strings + offset;
+		}
+	}
+	for (u32 i = 0; i < dd->node_count; i++) {
+		DecisionNode* node = dd->nodes + i;
+		if (node->first_branch > dd->branch_count || node->branch_count > dd->branch_count - node->first_branch ||
+			!DecisionChildValid(dd, node->default_child, i)) {
+			return false;
+		}
+		for (u32 b = 0; b < node->branch_count; b++) {
+			if (!DecisionChildValid(dd, dd->branches[node->first_branch + b].child, i)) {
+				return false;
+			}
+		}
+	}
+	for (u32 i = 0; i < dd->leaf_count; i++) {
+		DecisionLeaf* leaf = dd->leaves + i;
+		if (leaf->first_rule > dd->leaf_rule_count || leaf->rule_count > dd->leaf_rule_count - leaf->first_rule) {
+			return false;
+		}
+	}
+	return DecisionChildValid(dd, dd->root, dd->node_count);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+//NOTE: children with this bit set index into the leaf table instead of the node table
+#define DECISION_LEAF_BIT 0x80000000u
+#define DECISION_DIAGRAM_MAGIC 0x43444443u //"CDDC"
+
+struct DecisionBranch {
+	Value value;
+	u32 child;
+};
+
+//NOTE: reads one condition and follows the branch matching its value, or default_child when none match
+struct DecisionNode {
+	ConditionRef condition;
+	u32 first_branch;
+	u32 branch_count;
+	u32 default_child;
+};
+
+struct DecisionLeaf {
+	u32 first_rule;
+	u32 rule_count;
+};
+
+struct DecisionDiagram {
+	u32 root;
+
+	DecisionNode* nodes;
+	u32 node_count;
+	u32 node_capacity;
+
+	DecisionBranch* branches;
+	u32 branch_count;
+	u32 branch_capacity;
+
+	DecisionLeaf* leaves;
+	u32 leaf_count;
+	u32 leaf_capacity;
+
+	RuleId* leaf_rules;
+	u32 leaf_rule_count;
+	u32 leaf_rule_capacity;
+};
+
+//NOTE: layout of a compiled diagram on disk, the four tables follow the header in order and then the
+//string constants. Every section starts on a DECISION_SECTION_ALIGN boundary from the start of the file.
+//String branch values hold offsets into the string block.
+#define DECISION_SECTION_ALIGN alignof(DecisionBranch)
+
+struct DecisionDiagramFileHeader {
+	u32 magic;
+	u32 root;
+	u32 node_count;
+	u32 branch_count;
+	u32 leaf_count;
+	u32 leaf_rule_count;
+	u32 string_bytes;
+};
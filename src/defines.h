@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <float.h>
 
 #define PI32 3.14159265395f
 #define F32Max FLT_MAX 
@@ -54,6 +55,12 @@ typedef uint8_t b8;
     #endif
 #endif
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define DARCH_X86 1
+#else
+    #define DARCH_X86 0
+#endif
+
 #ifdef DEXPORT
     #ifdef _MSC_VER
         #define DAPI __declspec(dllexport)
@@ -72,6 +79,23 @@ typedef uint8_t b8;
 #define DCLAMP_MAX(value, max) (value > max) ? max : value;
 #define DCLAMP_MIN(value, min) (value < min) ? min : value;
 
+#ifdef _MSC_VER
+    #include <xmmintrin.h>
+    #define Prefetch(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+    #define Prefetch(address) __builtin_prefetch(address)
+#endif
+
+//NOTE: for the body of a spin wait, lets the core know so it doesn't speculate ahead or starve its sibling
+#if DARCH_X86
+    #include <emmintrin.h>
+    #define SpinPause() _mm_pause()
+#elif defined(__aarch64__)
+    #define SpinPause() __asm__ __volatile__("yield")
+#else
+    #define SpinPause()
+#endif
+
 #define DINLINE
 //#ifdef _MSC_VER
 //    #define DINLINE __forceinline
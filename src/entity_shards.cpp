@@ -0,0 +1,87 @@
+#include "entity_shards.h"
+
+static void EntityShardWork(EntityShards* shards, EntityShard* shard) {
+	shard->pinned = PlatformPinThreadToNumaNode(shard->node);
+	shards->store->CommitEntityRangeOnNode(shard->first_entity, shard->end_entity, shard->node);
+
+	u64 done = 0;
+	shard->finished_batch.store(done, std::memory_order_release);
+	for (;;) {
+		u64 batch = shards->batch.load(std::memory_order_acquire);
+		if (batch == done) {
+			if (shards->stopping.load(std::memory_order_acquire)) {
+				return;
+			}
+			std::this_thread::yield();
+			continue;
+		}
+		for (u32 i = 0; i < shards->batch_rule_count; i++) {
+			RunRuleForEntityRange(shards->rule_table, shards->store, shards->batch_rules[i], shard->first_entity, shard->end_entity);
+		}
+		done = batch;
+		shard->finished_batch.store(done, std::memory_order_release);
+	}
+}
+
+//NOTE: splits the store's entity capacity into shard_count ranges and gives them to the NUMA nodes
+//round robin. Call after the store's conditions are added and before entities are created, so
+//nothing touches a shard's pages before its worker does.
+void EntityShardsStart(EntityShards* shards, EntityStore* store, RuleTable* rule_table, u32 shard_count) {
+	DASSERT(shard_count > 0 && shard_count <= MAX_ENTITY_SHARDS);
+	shards->store = store;
+	shards->rule_table = rule_table;
+	shards->shard_count = shard_count;
+	shards->batch_rules = 0;
+	shards->batch_rule_count = 0;
+	shards->batch.store(0);
+	shards->stopping.store(false);
+
+	u32 node_count = PlatformNumaNodeCount();
+	u32 per_shard = (store->entity_capacity + shard_count - 1) / shard_count;
+	per_shard = (per_shard + ENTITY_SHARD_ALIGNMENT - 1) / ENTITY_SHARD_ALIGNMENT * ENTITY_SHARD_ALIGNMENT;
+	for (u32 i = 0; i < shard_count; i++) {
+		EntityShard* shard = shards->shards + i;
+		shard->node = i % node_count;
+		shard->first_entity = Minimum(i * per_shard, store->entity_capacity);
+		shard->end_entity = Minimum(shard->first_entity + per_shard, store->entity_capacity);
+		shard->finished_batch.store(INVALID_ID);
+		shard->worker = std::thread(EntityShardWork, shards, shard);
+	}
+	for (u32 i = 0; i < shard_count; i++) {
+		while (shards->shards[i].finished_batch.load(std::memory_order_acquire) != 0) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+//NOTE: runs the rules in order over every shard at once and returns when all shards are done.
+//Rules run against one entity at a time, so shards never touch each other's entities.
+void EntityShardsRunRules(EntityShards* shards, RuleId* rules, u32 rule_count) {
+	shards->batch_rules = rules;
+	shards->batch_rule_count = rule_count;
+	u64 batch = shards->batch.load(std::memory_order_relaxed) + 1;
+	shards->batch.store(batch, std::memory_order_release);
+	for (u32 i = 0; i < shards->shard_count; i++) {
+		while (shards->shards[i].finished_batch.load(std::memory_order_acquire) != batch) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+//NOTE: the shard an entity's conditions live in, so callers can route work to the owning worker
+u32 EntityShardFor(EntityShards* shards, u32 entity) {
+	for (u32 i = 0; i < shards->shard_count; i++) {
+		if (entity < shards->shards[i].end_entity) {
+			return i;
+		}
+	}
+	return shards->shard_count - 1;
+}
+
+void EntityShardsStop(EntityShards* shards) {
+	shards->stopping.store(true, std::memory_order_release);
+	for (u32 i = 0; i < shards->shard_count; i++) {
+		shards->shards[i].worker.join();
+	}
+	shards->shard_count = 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <thread>
+
+#define MAX_ENTITY_SHARDS 64
+//NOTE: shard boundaries are a multiple of this many entities so no column page is split between two nodes
+#define ENTITY_SHARD_ALIGNMENT PAGE_SIZE
+
+//NOTE: one worker per shard, pinned to the shard's node. The worker commits the shard's column pages
+//itself so they are placed on its node, then runs every batch of rules over just its own entities.
+struct alignas(64) EntityShard {
+	u32 node;
+	u32 first_entity;
+	u32 end_entity;
+	b8 pinned;
+	std::thread worker;
+	std::atomic<u64> finished_batch;
+};
+
+struct EntityShards {
+	EntityStore* store;
+	RuleTable* rule_table;
+	EntityShard shards[MAX_ENTITY_SHARDS];
+	u32 shard_count;
+
+	RuleId* batch_rules;
+	u32 batch_rule_count;
+	std::atomic<u64> batch;
+	std::atomic<b8> stopping;
+};
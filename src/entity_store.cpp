@@ -0,0 +1,289 @@
+#include "entity_store.h"
+
+//NOTE: every thread that binds an entity gets a slot, released again when the thread exits so
+//shard workers coming and going don't run out of them
+static std::atomic<u64> entity_binding_slots_used;
+
+struct EntityBindingSlotOwner {
+	u32 slot = ENTITY_BINDING_SLOTS;
+
+	~EntityBindingSlotOwner() {
+		if (slot < ENTITY_BINDING_SLOTS) {
+			entity_binding_slots_used.fetch_and(~(1ULL << slot));
+		}
+	}
+};
+
+static thread_local EntityBindingSlotOwner entity_binding_slot;
+
+static u32 EntityBindingSlot() {
+	if (entity_binding_slot.slot == ENTITY_BINDING_SLOTS) {
+		u64 used = entity_binding_slots_used.load();
+		u32 slot;
+		do {
+			DASSERT(used != ~0ULL);
+			slot = 0;
+			while (used & (1ULL << slot)) {
+				slot++;
+			}
+		} while (!entity_binding_slots_used.compare_exchange_weak(used, used | (1ULL << slot)));
+		entity_binding_slot.slot = slot;
+	}
+	return entity_binding_slot.slot;
+}
+
+//NOTE: all entities share one rule set, the store holds every entity's copy of every condition.
+//Removed entities go on a free list and their index is handed out again by CreateEntity.
+struct EntityStore {
+	u32 entity_capacity;
+	u32 entity_high_water;
+	u32 committed_entities;
+	u32 entity_count;
+	//NOTE: per store and per thread so shards can run rules over their own entities at the same
+	//time and two stores used from one thread keep their own binding
+	EntityBinding bindings[ENTITY_BINDING_SLOTS];
+
+	b8* alive;
+	u32* free_entities;
+	u32 free_count;
+
+	EntityColumnSet bools;
+	EntityColumnSet chars;
+	EntityColumnSet floats;
+	EntityColumnSet strings;
+
+	static u8* ReserveColumn(u32 max_entities, u32 element_size) {
+		u32 page_count = (u32)(((u64)max_entities * element_size + PAGE_SIZE - 1) / PAGE_SIZE);
+		return (u8*)ReservePage(0, page_count);
+	}
+
+	static void CommitColumn(u8* column, u32 element_size, u32 from_entity, u32 to_entity) {
+		u64 first_page = (u64)from_entity * element_size / PAGE_SIZE;
+		u64 end_page = ((u64)to_entity * element_size + PAGE_SIZE - 1) / PAGE_SIZE;
+		if (end_page > first_page) {
+			CommitPage(column + first_page * PAGE_SIZE, (u32)(end_page - first_page));
+		}
+	}
+
+	void InitColumnSet(EntityColumnSet* set, u32 element_size) {
+		set->count = 0;
+		set->element_size = element_size;
+		set->defaults = (u8*)ReserveAndCommitPage(0, (ENTITY_MAX_COLUMNS * element_size + PAGE_SIZE - 1) / PAGE_SIZE);
+	}
+
+	void Init(u32 max_entities) {
+		entity_capacity = max_entities;
+		entity_high_water = 0;
+		committed_entities = 0;
+		entity_count = 0;
+		for (u32 i = 0; i < ENTITY_BINDING_SLOTS; i++) {
+			bindings[i].entity = 0;
+		}
+		free_count = 0;
+		//NOTE: the free list sits after the alive flags, rounded up so its u32s are aligned
+		u64 free_list_offset = ((u64)max_entities + alignof(u32) - 1) & ~((u64)alignof(u32) - 1);
+		u32 bookkeeping_pages = (u32)((free_list_offset + (u64)max_entities * sizeof(u32) + PAGE_SIZE - 1) / PAGE_SIZE);
+		alive = (b8*)ReserveAndCommitPage(0, bookkeeping_pages);
+		free_entities = (u32*)(alive + free_list_offset);
+		InitColumnSet(&bools, sizeof(b8));
+		InitColumnSet(&chars, sizeof(u8));
+		InitColumnSet(&floats, sizeof(f32));
+		InitColumnSet(&strings, ENTITY_STRING_SLOT_SIZE);
+	}
+
+	u32 AddColumn(EntityColumnSet* set, void* default_value) {
+		DASSERT(set->count < ENTITY_MAX_COLUMNS);
+		u32 id = set->count++;
+		u8* column = ReserveColumn(entity_capacity, set->element_size);
+		set->columns[id] = column;
+		MemCopy(default_value, set->defaults + id * set->element_size, set->element_size);
+		CommitColumn(column, set->element_size, 0, committed_entities);
+		for (u32 entity = 0; entity < entity_high_water; entity++) {
+			MemCopy(default_value, column + entity * set->element_size, set->element_size);
+		}
+		return id;
+	}
+
+	BoolConditionId AddBoolCondition(b8 default_value) {
+		return (BoolConditionId)AddColumn(&bools, &default_value);
+	}
+
+	CharConditionId AddCharCondition(u8 default_value) {
+		return (CharConditionId)AddColumn(&chars, &default_value);
+	}
+
+	FloatConditionId AddFloatCondition(f32 default_value) {
+		return (FloatConditionId)AddColumn(&floats, &default_value);
+	}
+
+	StringConditionId AddStringCondition(String default_value) {
+		u8 slot[ENTITY_STRING_SLOT_SIZE] = {};
+		DASSERT(default_value.length + 1 < ENTITY_STRING_SLOT_SIZE);
+		slot[0] = (u8)default_value.length;
+		MemCopy(default_value.data, slot + 1, default_value.length);
+		return (StringConditionId)AddColumn(&strings, slot);
+	}
+
+	StringConditionId AddStringCondition(u8* default_value) {
+		return AddStringCondition(StringFromC(default_value));
+	}
+
+	void CommitEntities(EntityColumnSet* set, u32 from_entity, u32 to_entity) {
+		for (u32 id = 0; id < set->count; id++) {
+			CommitColumn(set->columns[id], set->element_size, from_entity, to_entity);
+		}
+	}
+
+	//NOTE: for the thread that owns the range, the range has to start and end on a page boundary in every column
+	void CommitEntitiesOnNode(EntityColumnSet* set, u32 from_entity, u32 to_entity, u32 node) {
+		for (u32 id = 0; id < set->count; id++) {
+			u64 first_page = (u64)from_entity * set->element_size / PAGE_SIZE;
+			u64 end_page = ((u64)to_entity * set->element_size + PAGE_SIZE - 1) / PAGE_SIZE;
+			if (end_page > first_page) {
+				PlatformCommitPageOnNumaNode(set->columns[id] + first_page * PAGE_SIZE, (u32)(end_page - first_page), node);
+			}
+		}
+	}
+
+	void CommitEntityRangeOnNode(u32 from_entity, u32 to_entity, u32 node) {
+		CommitEntitiesOnNode(&bools, from_entity, to_entity, node);
+		CommitEntitiesOnNode(&chars, from_entity, to_entity, node);
+		CommitEntitiesOnNode(&floats, from_entity, to_entity, node);
+		CommitEntitiesOnNode(&strings, from_entity, to_entity, node);
+	}
+
+	void ResetEntity(EntityColumnSet* set, u32 entity) {
+		for (u32 id = 0; id < set->count; id++) {
+			MemCopy(set->defaults + id * set->element_size, set->columns[id] + entity * set->element_size, set->element_size);
+		}
+	}
+
+	u32 CreateEntity() {
+		u32 entity;
+		if (free_count > 0) {
+			entity = free_entities[--free_count];
+		} else {
+			DASSERT(entity_high_water < entity_capacity);
+			entity = entity_high_water++;
+			if (entity_high_water > committed_entities) {
+				u32 next_committed = Minimum(committed_entities + ENTITY_COMMIT_STEP, entity_capacity);
+				CommitEntities(&bools, committed_entities, next_committed);
+				CommitEntities(&chars, committed_entities, next_committed);
+				CommitEntities(&floats, committed_entities, next_committed);
+				CommitEntities(&strings, committed_entities, next_committed);
+				committed_entities = next_committed;
+			}
+		}
+		ResetEntity(&bools, entity);
+		ResetEntity(&chars, entity);
+		ResetEntity(&floats, entity);
+		ResetEntity(&strings, entity);
+		alive[entity] = true;
+		entity_count++;
+		return entity;
+	}
+
+	void RemoveEntity(u32 entity) {
+		DASSERT(entity < entity_high_water && alive[entity]);
+		alive[entity] = false;
+		free_entities[free_count++] = entity;
+		entity_count--;
+	}
+
+	void BindEntity(u32 entity) {
+		DASSERT(entity < entity_high_water && alive[entity]);
+		bindings[EntityBindingSlot()].entity = entity;
+	}
+
+	u32 BoundEntity() {
+		return bindings[EntityBindingSlot()].entity;
+	}
+
+	b8 QueryCondition(u32 entity, BoolConditionId condition) {
+		DASSERT(condition < bools.count && entity < entity_high_water);
+		return *(bools.columns[condition] + entity);
+	}
+
+	u8 QueryCondition(u32 entity, CharConditionId condition) {
+		DASSERT(condition < chars.count && entity < entity_high_water);
+		return *(chars.columns[condition] + entity);
+	}
+
+	f32 QueryCondition(u32 entity, FloatConditionId condition) {
+		DASSERT(condition < floats.count && entity < entity_high_water);
+		return *((f32*)floats.columns[condition] + entity);
+	}
+
+	//NOTE: points past the length byte, the string is NUL terminated inside its slot
+	u8* QueryCondition(u32 entity, StringConditionId condition) {
+		DASSERT(condition < strings.count && entity < entity_high_water);
+		return strings.columns[condition] + entity * ENTITY_STRING_SLOT_SIZE + 1;
+	}
+
+	String QueryConditionString(u32 entity, StringConditionId condition) {
+		u8* result = QueryCondition(entity, condition);
+		return Str(result, *(result - 1));
+	}
+
+	void SetConditionValue(u32 entity, BoolConditionId condition, b8 value) {
+		DASSERT(condition < bools.count && entity < entity_high_water);
+		*(bools.columns[condition] + entity) = value;
+	}
+
+	void SetConditionValue(u32 entity, CharConditionId condition, u8 value) {
+		DASSERT(condition < chars.count && entity < entity_high_water);
+		*(chars.columns[condition] + entity) = value;
+	}
+
+	void SetConditionValue(u32 entity, FloatConditionId condition, f32 value) {
+		DASSERT(condition < floats.count && entity < entity_high_water);
+		*((f32*)floats.columns[condition] + entity) = value;
+	}
+
+	void SetConditionValue(u32 entity, StringConditionId condition, String value) {
+		DASSERT(condition < strings.count && entity < entity_high_water);
+		DASSERT(value.length + 1 < ENTITY_STRING_SLOT_SIZE);
+		u8* slot = strings.columns[condition] + entity * ENTITY_STRING_SLOT_SIZE;
+		*slot = (u8)value.length;
+		MemCopy(value.data, slot + 1, value.length);
+		slot[value.length + 1] = '\0';
+	}
+
+	void SetConditionValue(u32 entity, StringConditionId condition, u8* value) {
+		SetConditionValue(entity, condition, StringFromC(value));
+	}
+
+	//NOTE: the bound entity versions are what rule funcs call, RunRuleForEntities does the binding
+	b8 QueryCondition(BoolConditionId condition) { return QueryCondition(BoundEntity(), condition); }
+	u8 QueryCondition(CharConditionId condition) { return QueryCondition(BoundEntity(), condition); }
+	f32 QueryCondition(FloatConditionId condition) { return QueryCondition(BoundEntity(), condition); }
+	u8* QueryCondition(StringConditionId condition) { return QueryCondition(BoundEntity(), condition); }
+	String QueryConditionString(StringConditionId condition) { return QueryConditionString(BoundEntity(), condition); }
+
+	void SetConditionValue(BoolConditionId condition, b8 value) { SetConditionValue(BoundEntity(), condition, value); }
+	void SetConditionValue(CharConditionId condition, u8 value) { SetConditionValue(BoundEntity(), condition, value); }
+	void SetConditionValue(FloatConditionId condition, f32 value) { SetConditionValue(BoundEntity(), condition, value); }
+	void SetConditionValue(StringConditionId condition, String value) { SetConditionValue(BoundEntity(), condition, value); }
+	void SetConditionValue(StringConditionId condition, u8* value) { SetConditionValue(BoundEntity(), condition, value); }
+};
+
+void RunRuleForEntity(RuleTable* rule_table, EntityStore* store, RuleId rule, u32 entity) {
+	store->BindEntity(entity);
+	rule_table->RunRule(rule);
+}
+
+//NOTE: walks entities in index order so each column is read front to back
+void RunRuleForEntityRange(RuleTable* rule_table, EntityStore* store, RuleId rule, u32 from_entity, u32 to_entity) {
+	to_entity = Minimum(to_entity, store->entity_high_water);
+	EntityBinding* binding = &store->bindings[EntityBindingSlot()];
+	for (u32 entity = from_entity; entity < to_entity; entity++) {
+		if (store->alive[entity]) {
+			binding->entity = entity;
+			rule_table->RunRule(rule);
+		}
+	}
+}
+
+void RunRuleForEntities(RuleTable* rule_table, EntityStore* store, RuleId rule) {
+	RunRuleForEntityRange(rule_table, store, rule, 0, store->entity_high_water);
+}
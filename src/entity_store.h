@@ -0,0 +1,21 @@
+#pragma once
+#include <atomic>
+
+#define ENTITY_MAX_COLUMNS 256
+#define ENTITY_STRING_SLOT_SIZE 32
+#define ENTITY_COMMIT_STEP 4096
+#define ENTITY_BINDING_SLOTS 64
+
+//NOTE: one per thread slot inside each store, padded so shards binding at the same time don't share a line
+struct alignas(64) EntityBinding {
+	u32 entity;
+};
+
+//NOTE: one contiguous array per condition, indexed by entity. Strings get a fixed slot with the
+//length in the first byte, same header layout as the StringTable.
+struct EntityColumnSet {
+	u8* columns[ENTITY_MAX_COLUMNS];
+	u8* defaults;
+	u32 count;
+	u32 element_size;
+};
@@ -3,16 +3,37 @@
 #include "core/dmemory.cpp"
 #include "core/logger.cpp"
 #include "core/dstring.cpp"
+#include "core/dnumber.cpp"
 #include "platform_services.cpp"
 #include "scanner.cpp"
 #include "chunk.cpp"
+#include "condition_index.cpp"
 #include "condition_tables.cpp"
+#include "rete_network.cpp"
+#ifdef RULE_MEMO_ENABLED
+#include "rule_memo.cpp"
+#endif
+#include "rule_scheduler.cpp"
+#include "decision_diagram.cpp"
+#include "entity_store.cpp"
+#include "entity_shards.cpp"
+#include "snapshot_table.cpp"
+#include "persistent_tables.cpp"
+#include "condition_registry.cpp"
+#include "rule_reload.cpp"
+#include <wchar.h>
 
 static RuleTable rule_table;
 static BoolTable bool_table;
 static CharTable char_table;
 static FloatTable float_table;
 static StringTable string_table;
+static IntTable int_table;
+static ConditionTables condition_tables = {&bool_table, &char_table, &float_table, &string_table, &int_table};
+static ReteNetwork rete_network;
+static EntityStore entity_store;
+static ConditionRegistry condition_registry;
+static RuleReload rule_reload;
 
 void OpenGate3() {
 	if (bool_table.QueryCondition(GATE_1_OPEN) && bool_table.QueryCondition(GATE_2_OPEN)) {
@@ -33,14 +54,606 @@ void ModFloat3Value() {
 }
 
 void ModStringValue() {
-	u8* str1 = string_table.QueryCondition(STRING1_VALUE);
-	u8* str2 = string_table.QueryCondition(STRING2_VALUE);
-	if (StringsEqual(str1, (u8*)"string1") && StringsEqual(str2, (u8*)"string2")) {
-		string_table.SetConditionValue(STRING3_VALUE, (u8*)"string4");
+	String str1 = string_table.QueryConditionString(STRING1_VALUE);
+	String str2 = string_table.QueryConditionString(STRING2_VALUE);
+	if (StringsEqual(str1, StringLiteral("string1")) && StringsEqual(str2, StringLiteral("string2"))) {
+		string_table.SetConditionValue(STRING3_VALUE, StringLiteral("string4"));
 	}
 }
 
-int WINAPI wWinMain(HINSTANCE instance, HINSTANCE prev_instance, PWSTR cmd_line, int cmd_show) {
+//NOTE: same rule as OpenGate3 run against whichever entity RunRuleForEntities has bound
+void OpenEntityGate3() {
+	if (entity_store.QueryCondition(GATE_1_OPEN) && entity_store.QueryCondition(GATE_2_OPEN)) {
+		entity_store.SetConditionValue(GATE_3_OPEN, true);
+	}
+}
+
+//NOTE: the tests each rule above guards on, in the form the network shares between rules
+static ConditionTest open_gate_3_tests[] = {
+	{{CONDITION_TABLE_BOOL, GATE_1_OPEN}, TEST_EQUAL, BoolVal(true)},
+	{{CONDITION_TABLE_BOOL, GATE_2_OPEN}, TEST_EQUAL, BoolVal(true)}
+};
+static ConditionTest change_char3_tests[] = {
+	{{CONDITION_TABLE_CHAR, CHAR1_VALUE}, TEST_EQUAL, IntVal('a')},
+	{{CONDITION_TABLE_CHAR, CHAR2_VALUE}, TEST_EQUAL, IntVal('b')}
+};
+static ConditionTest change_float3_tests[] = {
+	{{CONDITION_TABLE_FLOAT, FLOAT1_VALUE}, TEST_EQUAL, NumberVal(1.0f)},
+	{{CONDITION_TABLE_FLOAT, FLOAT2_VALUE}, TEST_EQUAL, NumberVal(2.0f)}
+};
+static ConditionTest change_string_tests[] = {
+	{{CONDITION_TABLE_STRING, STRING1_VALUE}, TEST_EQUAL, StringVal(StringLiteral("string1"))},
+	{{CONDITION_TABLE_STRING, STRING2_VALUE}, TEST_EQUAL, StringVal(StringLiteral("string2"))}
+};
+static RuleConditions rule_conditions[] = {
+	{OPEN_GATE_3, open_gate_3_tests, ArrayCount(open_gate_3_tests)},
+	{CHANGE_CHAR3, change_char3_tests, ArrayCount(change_char3_tests)},
+	{CHANGE_FLOAT3, change_float3_tests, ArrayCount(change_float3_tests)},
+	{CHANGE_STRING, change_string_tests, ArrayCount(change_string_tests)}
+};
+
+void BuildRuleNetwork(MemoryArena* arena) {
+	ReteInit(&rete_network, arena, &condition_tables, 64, 16, 64);
+	for (u32 i = 0; i < ArrayCount(rule_conditions); i++) {
+		ReteAddRule(&rete_network, rule_conditions[i].rule, rule_conditions[i].tests, rule_conditions[i].test_count);
+	}
+	ReteEvaluateAll(&rete_network);
+}
+
+//NOTE: the demo rules and the starting values their conditions get in the match modes
+static void InitDemoTables() {
+	rule_table.Init(0, MegaBytes(1));
+	rule_table.AddRule(OpenGate3);
+	rule_table.AddRule(ModChar3Value);
+	rule_table.AddRule(ModFloat3Value);
+	rule_table.AddRule(ModStringValue);
+
+	bool_table.Init(0, MegaBytes(1));
+	bool_table.AddCondition(true);
+	bool_table.AddCondition(true);
+	bool_table.AddCondition(false);
+	char_table.Init(0, MegaBytes(1));
+	char_table.AddCondition('a');
+	char_table.AddCondition('b');
+	char_table.AddCondition('c');
+	float_table.Init(0, MegaBytes(1));
+	float_table.AddCondition(1.0f);
+	float_table.AddCondition(2.0f);
+	float_table.AddCondition(3.0f);
+	string_table.Init(0);
+	string_table.AddCondition("string1");
+	string_table.AddCondition("string2");
+	string_table.AddCondition("string3");
+	int_table.Init(0, MegaBytes(1));
+}
+
+//NOTE: the demo rules run through the network. After the first pass only rules whose tests a write
+//touched run again, no matter how many rules there are.
+void MatchRules(MemoryArena* arena) {
+	InitDemoTables();
+	BuildRuleNetwork(arena);
+	u32 rules_run = ReteRunActivations(&rete_network, &rule_table);
+	DINFO("Matched %u rules on the first pass", rules_run);
+
+	bool_table.SetConditionValue(GATE_3_OPEN, false);
+	bool_table.SetConditionValue(GATE_1_OPEN, false);
+	rules_run = ReteRunActivations(&rete_network, &rule_table);
+	DINFO("Closing gate 1 ran %u rules, gate 3 is %d", rules_run, bool_table.QueryCondition(GATE_3_OPEN));
+	bool_table.SetConditionValue(GATE_1_OPEN, true);
+	rules_run = ReteRunActivations(&rete_network, &rule_table);
+	DINFO("Opening gate 1 ran %u rules, gate 3 is %d", rules_run, bool_table.QueryCondition(GATE_3_OPEN));
+}
+
+//NOTE: offline step, the written table is loaded back with DecisionDiagramLoad by MatchRuleDiagram
+b32 CompileRuleDiagram(MemoryArena* arena, MemoryArena* scratch, char* filename) {
+	DecisionDiagram diagram = {};
+	DecisionDiagramInit(&diagram, arena, 1024, 4096, 1024, 8192);
+	DecisionDiagramCompile(&diagram, scratch, rule_conditions, ArrayCount(rule_conditions));
+	DINFO("Compiled %d rules into %d decision nodes and %d leaves", ArrayCount(rule_conditions), diagram.node_count, diagram.leaf_count);
+	return DecisionDiagramWrite(&diagram, scratch, filename);
+}
+
+//NOTE: the online half, walks the compiled diagram once for the current values and runs what it matched
+b32 MatchRuleDiagram(char* filename) {
+	DebugReadFileResult file = DebugPlatformReadEntireFile(filename);
+	if (!file.contents) {
+		DERROR("Could not read %s, compile it with --compile-rules", filename);
+		return false;
+	}
+	DecisionDiagram diagram = {};
+	if (!DecisionDiagramLoad(&diagram, (u8*)file.contents, file.contents_size)) {
+		DERROR("%s isn't a valid decision diagram", filename);
+		DebugPlatformFreeFileMemory(file.contents);
+		return false;
+	}
+	InitDemoTables();
+	RuleId matched[ArrayCount(rule_conditions)];
+	u32 match_count = DecisionDiagramMatch(&diagram, &condition_tables, matched, ArrayCount(matched));
+	rule_table.RunRules(matched, match_count);
+	DINFO("Diagram matched %u rules, gate 3 is %d, char 3 is %c", match_count,
+		bool_table.QueryCondition(GATE_3_OPEN), char_table.QueryCondition(CHAR3_VALUE));
+	DebugPlatformFreeFileMemory(file.contents);
+	return true;
+}
+
+#define ENTITY_DEMO_COUNT 1000
+
+//NOTE: the gate rule run once per entity, every entity has its own copy of the gate conditions. Some
+//entities are removed and created again so their indices come back off the free list.
+void MatchEntityRules() {
+	rule_table.Init(0, MegaBytes(1));
+	entity_store.Init(100000);
+	entity_store.AddBoolCondition(true);
+	entity_store.AddBoolCondition(true);
+	entity_store.AddBoolCondition(false);
+	for (u32 entity = 0; entity < ENTITY_DEMO_COUNT; entity++) {
+		entity_store.CreateEntity();
+	}
+	for (u32 entity = 0; entity < ENTITY_DEMO_COUNT; entity += 4) {
+		entity_store.RemoveEntity(entity);
+	}
+	for (u32 entity = 0; entity < ENTITY_DEMO_COUNT; entity += 8) {
+		entity_store.CreateEntity();
+	}
+	RuleId open_entity_gate_3 = rule_table.AddRule(OpenEntityGate3);
+	RunRuleForEntities(&rule_table, &entity_store, open_entity_gate_3);
+	u32 open = 0;
+	for (u32 entity = 0; entity < entity_store.entity_high_water; entity++) {
+		open += entity_store.alive[entity] && entity_store.QueryCondition(entity, GATE_3_OPEN);
+	}
+	DINFO("Gate 3 is open for %u of %u entities", open, entity_store.entity_count);
+}
+
+//NOTE: every bench rule runs the same func on its own pair of float conditions scattered over a table
+//much bigger than the cache, so each rule's inputs arrive cold unless RunRules prefetched them
+static RuleInputs* bench_rule_inputs;
+
+void BenchRule() {
+	RuleInputs* inputs = bench_rule_inputs + rule_table.current_rule;
+	f32 a = float_table.QueryCondition((FloatConditionId)inputs->conditions[0].id);
+	f32 b = float_table.QueryCondition((FloatConditionId)inputs->conditions[1].id);
+	bool_table.SetConditionValue((BoolConditionId)(rule_table.current_rule & 1023), a > b);
+}
+
+static u32 BenchRandom(u32* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+void BenchmarkRunRules(MemoryArena* arena) {
+	u32 rule_count = 1 << 20;
+	u32 float_count = 1 << 24;
+	u32 random = 2463534242u;
+	rule_table.Init(0, rule_count * sizeof(RuleFunc*));
+	float_table.InitCommitted(0, float_count * sizeof(f32), PAGE_FLAG_HUGE|PAGE_FLAG_PREFAULT);
+	bool_table.Init(0, PAGE_SIZE);
+	for (u32 i = 0; i < 1024; i++) {
+		bool_table.AddCondition(false);
+	}
+	for (u32 i = 0; i < float_count; i++) {
+		float_table.AddCondition((f32)BenchRandom(&random));
+	}
+	bench_rule_inputs = PushArray(arena, rule_count, RuleInputs);
+	ConditionRef* refs = PushArray(arena, rule_count * 2, ConditionRef);
+	RuleId* rules = PushArray(arena, rule_count, RuleId);
+	for (u32 i = 0; i < rule_count; i++) {
+		rule_table.AddRule(BenchRule);
+		refs[i * 2] = {CONDITION_TABLE_FLOAT, BenchRandom(&random) % float_count};
+		refs[i * 2 + 1] = {CONDITION_TABLE_FLOAT, BenchRandom(&random) % float_count};
+		bench_rule_inputs[i] = {refs + i * 2, 2};
+		rules[i] = (RuleId)(BenchRandom(&random) % rule_count);
+	}
+
+	f64 start = PlatformGetSeconds();
+	for (u32 i = 0; i < rule_count; i++) {
+		rule_table.RunRule(rules[i]);
+	}
+	f64 one_at_a_time = PlatformGetSeconds() - start;
+
+	rule_table.SetRuleInputs(bench_rule_inputs, &condition_tables);
+	start = PlatformGetSeconds();
+	rule_table.RunRules(rules, rule_count);
+	f64 prefetched = PlatformGetSeconds() - start;
+
+	start = PlatformGetSeconds();
+	TempMemory scratch = GetScratch(&arena, 1);
+	SortRulesForLocality(rules, rule_count, PushArray(scratch.arena, rule_count, RuleId));
+	ReleaseScratch(scratch);
+	f64 sort_time = PlatformGetSeconds() - start;
+	start = PlatformGetSeconds();
+	rule_table.RunRules(rules, rule_count);
+	f64 sorted = PlatformGetSeconds() - start;
+
+	DINFO("RunRule x%u: %.2f ms", rule_count, one_at_a_time * 1000.0);
+	DINFO("RunRules prefetched: %.2f ms (%.2fx)", prefetched * 1000.0, one_at_a_time / prefetched);
+	DINFO("RunRules sorted and prefetched: %.2f ms (%.2fx), sort took %.2f ms", sorted * 1000.0, one_at_a_time / sorted, sort_time * 1000.0);
+}
+
+//NOTE: the byte at a time versions dstring used before, kept here to measure against
+static u32 ScalarStringLength(u8* str) {
+	u32 result = 0;
+	while (str[result]) {
+		result++;
+	}
+	return result + 1;
+}
+
+static b8 ScalarStringsEqual(u8* str1, u8* str2) {
+	while (*str1 && *str1 == *str2) {
+		str1++;
+		str2++;
+	}
+	return *str1 == *str2;
+}
+
+static b8 ScalarStringsEquali(u8* str1, u8* str2) {
+	while (*str1 && ToLower(*str1) == ToLower(*str2)) {
+		str1++;
+		str2++;
+	}
+	return ToLower(*str1) == ToLower(*str2);
+}
+
+static u8* ScalarStringFindByte(u8* str, u8 byte) {
+	for (; *str; str++) {
+		if (*str == byte) {
+			return str;
+		}
+	}
+	return 0;
+}
+
+#define BENCH_STRING_COUNT 256
+
+//NOTE: each length gets BENCH_STRING_COUNT strings at different alignments so the unaligned paths are measured too.
+//Compares are between equal strings, the case where every byte has to be looked at.
+void BenchmarkStrings(MemoryArena* arena) {
+	u32 lengths[] = {3, 8, 15, 32, 100, 1000, 10000};
+	u32 random = 2463534242u;
+	for (u32 l = 0; l < ArrayCount(lengths); l++) {
+		u32 length = lengths[l];
+		TempMemory temp = BeginTempMemory(arena);
+		u8** strings = PushArray(arena, BENCH_STRING_COUNT, u8*);
+		u8** copies = PushArray(arena, BENCH_STRING_COUNT, u8*);
+		u8** upper_copies = PushArray(arena, BENCH_STRING_COUNT, u8*);
+		for (u32 i = 0; i < BENCH_STRING_COUNT; i++) {
+			strings[i] = PushSize(arena, length + 1 + 16) + i % 16;
+			copies[i] = PushSize(arena, length + 1 + 16) + (i * 7) % 16;
+			upper_copies[i] = PushSize(arena, length + 1 + 16) + (i * 3) % 16;
+			for (u32 c = 0; c < length; c++) {
+				strings[i][c] = 'a' + BenchRandom(&random) % 26;
+				copies[i][c] = strings[i][c];
+				upper_copies[i][c] = strings[i][c] - ('a' - 'A');
+			}
+			strings[i][length] = 0;
+			copies[i][length] = 0;
+			upper_copies[i][length] = 0;
+		}
+		u32 repeats = Maximum(1u, 4000000 / (length * BENCH_STRING_COUNT));
+		u64 check = 0;
+		f64 times[9];
+		f64 start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += ScalarStringLength(strings[i]);
+		times[0] = PlatformGetSeconds() - start;
+		start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += StringLength(strings[i]);
+		times[1] = PlatformGetSeconds() - start;
+		start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += ScalarStringsEquali(strings[i], upper_copies[i]);
+		times[2] = PlatformGetSeconds() - start;
+		start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += StringsEquali((char*)strings[i], (char*)upper_copies[i]);
+		times[3] = PlatformGetSeconds() - start;
+		start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += ScalarStringsEqual(strings[i], copies[i]);
+		times[4] = PlatformGetSeconds() - start;
+		start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += StringsEqual(strings[i], copies[i]);
+		times[5] = PlatformGetSeconds() - start;
+		start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += StringsEqualN(strings[i], length, copies[i], length);
+		times[6] = PlatformGetSeconds() - start;
+		start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += ScalarStringFindByte(strings[i], '!') != 0;
+		times[7] = PlatformGetSeconds() - start;
+		start = PlatformGetSeconds();
+		for (u32 r = 0; r < repeats; r++) for (u32 i = 0; i < BENCH_STRING_COUNT; i++) check += StringFindByte(strings[i], '!') != 0;
+		times[8] = PlatformGetSeconds() - start;
+		EndTempMemory(temp);
+		DINFO("length %5u: length %.2fx, equali %.2fx, equal %.2fx, equal with lengths %.2fx, find byte %.2fx (check %llu)", length,
+			times[0] / times[1], times[2] / times[3], times[4] / times[5], times[4] / times[6], times[7] / times[8], check);
+	}
+}
+
+#define BENCH_NUMBER_COUNT (1 << 20)
+
+//NOTE: literals like a generated rule file has, separated by spaces. The old path ran atof straight on the source.
+void BenchmarkNumbers(MemoryArena* arena) {
+	u32 random = 2463534242u;
+	TempMemory temp = BeginTempMemory(arena);
+	u8* text = PushSize(arena, BENCH_NUMBER_COUNT * 32);
+	u8** starts = PushArray(arena, BENCH_NUMBER_COUNT, u8*);
+	u32* lengths = PushArray(arena, BENCH_NUMBER_COUNT, u32);
+	u8* at = text;
+	for (u32 i = 0; i < BENCH_NUMBER_COUNT; i++) {
+		starts[i] = at;
+		u32 whole = BenchRandom(&random) % 100000;
+		u32 fraction = BenchRandom(&random) % 1000000;
+		lengths[i] = (u32)snprintf((char*)at, 32, "%u.%u", whole, fraction);
+		at += lengths[i];
+		*at++ = ' ';
+	}
+	*at = 0;
+
+	f64 old_sum = 0;
+	f64 start = PlatformGetSeconds();
+	for (u32 i = 0; i < BENCH_NUMBER_COUNT; i++) {
+		old_sum += atof((char*)starts[i]);
+	}
+	f64 old_time = PlatformGetSeconds() - start;
+	f64 new_sum = 0;
+	start = PlatformGetSeconds();
+	for (u32 i = 0; i < BENCH_NUMBER_COUNT; i++) {
+		f32 value;
+		ParseF32(starts[i], lengths[i], &value);
+		new_sum += value;
+	}
+	f64 new_time = PlatformGetSeconds() - start;
+	u32 mismatches = 0;
+	for (u32 i = 0; i < BENCH_NUMBER_COUNT; i++) {
+		f32 value;
+		ParseF32(starts[i], lengths[i], &value);
+		mismatches += value != strtof((char*)starts[i], 0);
+	}
+	EndTempMemory(temp);
+	DINFO("floats x%u: atof %.2f ms, ParseF32 %.2f ms (%.2fx), sums %.1f %.1f, %u differ from strtof",
+		BENCH_NUMBER_COUNT, old_time * 1000.0, new_time * 1000.0, old_time / new_time, old_sum, new_sum, mismatches);
+}
+
+#define SNAPSHOT_QUERY_THREADS 4
+#define SNAPSHOT_QUERY_CONDITIONS 4096
+#define SNAPSHOT_QUERY_ROUNDS 2000
+#define SNAPSHOT_QUERY_WRITES 64
+
+static ConditionSnapshots condition_snapshots;
+static std::atomic<b32> snapshot_queries_done;
+
+//NOTE: the writer only publishes with every float condition equal to the int condition with the same id,
+//a reader that sees the two differ was handed a torn snapshot
+static void SnapshotQueryThread(u32 reader, u64* reads, u64* torn) {
+	while (!snapshot_queries_done.load(std::memory_order_relaxed)) {
+		ConditionSnapshot* snapshot = ConditionSnapshotsBeginRead(&condition_snapshots, reader);
+		for (u32 id = 0; id < SNAPSHOT_QUERY_CONDITIONS; id++) {
+			Value number = QuerySnapshotValue(snapshot, {CONDITION_TABLE_FLOAT, id});
+			Value integer = QuerySnapshotValue(snapshot, {CONDITION_TABLE_INT, id});
+			*torn += !ValuesEqual(number, integer);
+		}
+		ConditionSnapshotsEndRead(&condition_snapshots, reader);
+		(*reads)++;
+	}
+}
+
+#define SNAPSHOT_UPDATE_QUEUE_SIZE 1024
+
+//NOTE: picks the writes for every round and hands them to the thread that owns the tables
+static void SnapshotIngestThread(MpmcRing<ConditionUpdate>* updates) {
+	u32 random = 2463534242u;
+	for (u32 round = 1; round <= SNAPSHOT_QUERY_ROUNDS; round++) {
+		for (u32 i = 0; i < SNAPSHOT_QUERY_WRITES; i++) {
+			u32 id = BenchRandom(&random) % SNAPSHOT_QUERY_CONDITIONS;
+			ConditionUpdate round_updates[2] = {
+				{{CONDITION_TABLE_FLOAT, id}, NumberVal((f32)round)},
+				{{CONDITION_TABLE_INT, id}, IntVal(round)}
+			};
+			for (u32 pushed = 0; pushed < 2;) {
+				u32 count = MpmcRingPushBatch(updates, round_updates + pushed, 2 - pushed);
+				if (count == 0) {
+					std::this_thread::yield();
+				}
+				pushed += count;
+			}
+		}
+	}
+}
+
+//NOTE: an ingest thread queues writes, the owning thread applies them a round at a time and publishes,
+//while query threads read published snapshots with no lock
+void QuerySnapshots(MemoryArena* arena) {
+	bool_table.Init(0, MegaBytes(1));
+	char_table.Init(0, MegaBytes(1));
+	float_table.Init(0, MegaBytes(1));
+	string_table.Init(0);
+	int_table.Init(0, MegaBytes(1));
+	for (u32 id = 0; id < SNAPSHOT_QUERY_CONDITIONS; id++) {
+		float_table.AddCondition(0.0f);
+		int_table.AddCondition(0);
+	}
+	ConditionSnapshotsInit(&condition_snapshots, SNAPSHOT_QUERY_CONDITIONS);
+	ConditionSnapshotsAttach(&condition_snapshots, &condition_tables);
+	ConditionSnapshotsPublish(&condition_snapshots);
+
+	u64 reads[SNAPSHOT_QUERY_THREADS] = {};
+	u64 torn[SNAPSHOT_QUERY_THREADS] = {};
+	std::thread readers[SNAPSHOT_QUERY_THREADS];
+	for (u32 i = 0; i < SNAPSHOT_QUERY_THREADS; i++) {
+		readers[i] = std::thread(SnapshotQueryThread, i, reads + i, torn + i);
+	}
+	MpmcRing<ConditionUpdate> updates;
+	MpmcRingInit(arena, &updates, SNAPSHOT_UPDATE_QUEUE_SIZE);
+	f64 start = PlatformGetSeconds();
+	std::thread ingest(SnapshotIngestThread, &updates);
+	for (u32 round = 1; round <= SNAPSHOT_QUERY_ROUNDS; round++) {
+		u32 round_updates = SNAPSHOT_QUERY_WRITES * 2;
+		for (u32 applied = 0; applied < round_updates;) {
+			u32 count = ApplyConditionUpdates(&condition_tables, &updates, round_updates - applied);
+			if (count == 0) {
+				std::this_thread::yield();
+			}
+			applied += count;
+		}
+		ConditionSnapshotsPublish(&condition_snapshots);
+	}
+	f64 seconds = PlatformGetSeconds() - start;
+	ingest.join();
+	snapshot_queries_done.store(true);
+	u64 total_reads = 0;
+	u64 total_torn = 0;
+	for (u32 i = 0; i < SNAPSHOT_QUERY_THREADS; i++) {
+		readers[i].join();
+		total_reads += reads[i];
+		total_torn += torn[i];
+	}
+	DINFO("%u publishes in %.2f ms while %u readers took %llu snapshots, %llu torn reads",
+		SNAPSHOT_QUERY_ROUNDS, seconds * 1000.0, SNAPSHOT_QUERY_THREADS, total_reads, total_torn);
+}
+
+#define ARENA_STATS_INTERVAL 10.0
+#define CHECKPOINT_INTERVAL 10.0
+
+static PersistentTables persistent_tables;
+
+//NOTE: runs every rule in the script once, then again each time a change to the script has been compiled,
+//so edits are picked up without a restart. Rules only read conditions so far, nothing in the script can
+//change one. Conditions live in a mapped file, a restart with the same conditions file picks them up from
+//there instead of adding them again.
+void WatchRules(MemoryArena* arena, char* filename) {
+	ConditionRegistryInit(&condition_registry, arena, 256);
+	if (!LoadConditionsFile(&condition_registry, "conditions.txt")) {
+		return;
+	}
+	PersistentTableSizes sizes;
+	ConditionRegistryTableSizes(&condition_registry, &sizes);
+	if (!PersistentTablesOpen(&persistent_tables, "conditions.cnds", &sizes, &condition_tables)) {
+		return;
+	}
+	if (!ConditionRegistryMatchesTables(&condition_registry, &persistent_tables)) {
+		if (!persistent_tables.file.created) {
+			DWARN("conditions.cnds was saved from a different conditions file, starting over");
+			PersistentTablesClear(&persistent_tables);
+		}
+		if (!PersistentTablesReserve(&persistent_tables, &sizes)) {
+			return;
+		}
+		ConditionRegistryCreatePersistentConditions(&condition_registry, &persistent_tables);
+		PersistentTablesCheckpoint(&persistent_tables);
+	}
+	if (!RuleReloadInit(&rule_reload, arena, &condition_registry, filename, 256)) {
+		return;
+	}
+	f64 last_checkpoint = PlatformGetSeconds();
+	VM vm = {};
+	InitVM(&vm, &condition_tables);
+	b32 changed = true;
+	for (;;) {
+		if (changed) {
+			RuleSet* rules = RuleReloadEnter(&rule_reload, 0);
+			for (u32 i = 0; i < rules->rule_count; i++) {
+				RuleSetRun(rules, &vm, i);
+			}
+			RuleReloadExit(&rule_reload, 0);
+		}
+		changed = RuleReloadPoll(&rule_reload);
+		ArenaStatsDumpEvery(ARENA_STATS_INTERVAL);
+		if (PlatformGetSeconds() - last_checkpoint >= CHECKPOINT_INTERVAL) {
+			PersistentTablesCheckpoint(&persistent_tables);
+			last_checkpoint = PlatformGetSeconds();
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+}
+
+#define PROFILE_ROUNDS 4096
+#define PROFILE_REPEATS 64
+
+//NOTE: gives every registered condition a random value from its domain
+static void RandomizeConditions(ConditionRegistry* registry, u32* random) {
+	for (u32 i = 0; i < registry->entry_count; i++) {
+		ConditionEntry* entry = registry->entries + i;
+		if (entry->value_count > 0) {
+			SetConditionValue(&condition_tables, entry->ref, entry->values[BenchRandom(random) % entry->value_count]);
+		}
+	}
+}
+
+//NOTE: each rule in the script is compiled once with profiling on and run against random values from its
+//conditions' domains, then compiled again from that profile. The profiled chunk has to outlive its runs,
+//so it's kept in arena rather than going through Interpret. The reordered chunk is timed against the one
+//the rule loaded with, on the same values, and has to give the same result every round.
+void ProfileRules(MemoryArena* arena, char* filename) {
+	ConditionRegistryInit(&condition_registry, arena, 256);
+	if (!LoadConditionsFile(&condition_registry, "conditions.txt")) {
+		return;
+	}
+	bool_table.Init(0, MegaBytes(1));
+	char_table.Init(0, MegaBytes(1));
+	float_table.Init(0, MegaBytes(1));
+	string_table.Init(0);
+	int_table.Init(0, MegaBytes(1));
+	ConditionRegistryCreateConditions(&condition_registry, &condition_tables);
+	if (!RuleReloadInit(&rule_reload, arena, &condition_registry, filename, 256)) {
+		return;
+	}
+	RuleReloadStop(&rule_reload);
+
+	VM vm = {};
+	InitVM(&vm, &condition_tables);
+	vm.print_results = false;
+	RuleSet* rules = RuleReloadEnter(&rule_reload, 0);
+	for (u32 i = 0; i < rules->rule_count; i++) {
+		CompiledRule* rule = rules->rules[i];
+		TempMemory temp = BeginTempMemory(arena);
+		CompileOptions options = {};
+		options.registry = &condition_registry;
+		options.profile_conditions = true;
+		Chunk profiled;
+		InitChunk(arena, &profiled);
+		if (!Compile(rule->source, &profiled, &options)) {
+			EndTempMemory(temp);
+			continue;
+		}
+		u32 random = 2463534242u;
+		for (u32 round = 0; round < PROFILE_ROUNDS; round++) {
+			RandomizeConditions(&condition_registry, &random);
+			InterpretChunk(&vm, &profiled);
+		}
+
+		options.profile_conditions = false;
+		options.reorder_with = &profiled;
+		Chunk reordered;
+		InitChunk(arena, &reordered);
+		if (!Compile(rule->source, &reordered, &options)) {
+			EndTempMemory(temp);
+			continue;
+		}
+		f64 source_order = 0.0;
+		f64 profile_order = 0.0;
+		u32 mismatches = 0;
+		random = 2463534242u;
+		for (u32 round = 0; round < PROFILE_ROUNDS; round++) {
+			RandomizeConditions(&condition_registry, &random);
+			f64 start = PlatformGetSeconds();
+			for (u32 repeat = 0; repeat < PROFILE_REPEATS; repeat++) {
+				InterpretChunk(&vm, &rule->chunk);
+			}
+			source_order += PlatformGetSeconds() - start;
+			Value expected = vm.result;
+			start = PlatformGetSeconds();
+			for (u32 repeat = 0; repeat < PROFILE_REPEATS; repeat++) {
+				InterpretChunk(&vm, &reordered);
+			}
+			profile_order += PlatformGetSeconds() - start;
+			mismatches += !ValuesEqual(expected, vm.result);
+		}
+		DINFO("%.*s: source order %.2f ms, profile order %.2f ms (%.2fx), %u results differ", rule->name_length, rule->name,
+			source_order * 1000.0, profile_order * 1000.0, source_order / profile_order, mismatches);
+		EndTempMemory(temp);
+	}
+	RuleReloadExit(&rule_reload, 0);
+}
+
+static int RunMode(wchar_t* cmd_line) {
 	//u8* base_address = (u8*)TeraBytes(2);
 	//NOTE: this is probably overkill especially for the bool/char tables
 	/*
@@ -91,21 +704,145 @@ int WINAPI wWinMain(HINSTANCE instance, HINSTANCE prev_instance, PWSTR cmd_line,
 		else {
 			DINFO("   | ");
 		}
-		DINFO("%2d '%.*s'\n", token.type, token.length, token.start);
+		DINFO("%2d '%.*s'\n", token.type, token.text.length, token.text.data);
 	}
 	*/
 
+	if (cmd_line && wcsncmp(cmd_line, L"--compile-rules", 15) == 0) {
+		u32 compile_memory_size = MegaBytes(16);
+		MemoryArena diagram_arena = {};
+		MemoryArena diagram_scratch = {};
+		InitializeArena(&diagram_arena, compile_memory_size, (u8*)ReserveAndCommitPage(0, compile_memory_size / PAGE_SIZE));
+		InitializeArena(&diagram_scratch, compile_memory_size, (u8*)ReserveAndCommitPage(0, compile_memory_size / PAGE_SIZE));
+		ArenaRegister(&diagram_arena, "diagram");
+		ArenaRegister(&diagram_scratch, "diagram scratch");
+		b32 compiled = CompileRuleDiagram(&diagram_arena, &diagram_scratch, "rules.cdd");
+		ArenaStatsDump();
+		return compiled ? 0 : 1;
+	}
+
+	if (cmd_line && wcsncmp(cmd_line, L"--match-diagram", 15) == 0) {
+		return MatchRuleDiagram("rules.cdd") ? 0 : 1;
+	}
+
+	if (cmd_line && wcsncmp(cmd_line, L"--match-rules", 13) == 0) {
+		MemoryArena network_arena = {};
+		u32 network_memory_size = MegaBytes(1);
+		InitializeArena(&network_arena, network_memory_size, (u8*)ReserveAndCommitPage(0, network_memory_size / PAGE_SIZE));
+		ArenaRegister(&network_arena, "rete network");
+		MatchRules(&network_arena);
+		ArenaStatsDump();
+		return 0;
+	}
+
+	if (cmd_line && wcsncmp(cmd_line, L"--entity-rules", 14) == 0) {
+		MatchEntityRules();
+		return 0;
+	}
+
+	if (cmd_line && wcsncmp(cmd_line, L"--query-snapshots", 17) == 0) {
+		MemoryArena query_arena = {};
+		u32 query_memory_size = MegaBytes(1);
+		InitializeArena(&query_arena, query_memory_size, (u8*)ReserveAndCommitPage(0, query_memory_size / PAGE_SIZE));
+		ArenaRegister(&query_arena, "snapshot queries");
+		QuerySnapshots(&query_arena);
+		return 0;
+	}
+
+	if (cmd_line && wcsncmp(cmd_line, L"--bench-rules", 13) == 0) {
+		MemoryArena bench_arena = {};
+		u32 bench_memory_size = MegaBytes(64);
+		InitializeArena(&bench_arena, bench_memory_size, (u8*)ReserveAndCommitPage(0, bench_memory_size / PAGE_SIZE));
+		ArenaRegister(&bench_arena, "bench");
+		BenchmarkRunRules(&bench_arena);
+		ArenaStatsDump();
+		return 0;
+	}
+
+	if (cmd_line && wcsncmp(cmd_line, L"--bench-strings", 15) == 0) {
+		MemoryArena bench_arena = {};
+		u32 bench_memory_size = MegaBytes(16);
+		InitializeArena(&bench_arena, bench_memory_size, (u8*)ReserveAndCommitPage(0, bench_memory_size / PAGE_SIZE));
+		ArenaRegister(&bench_arena, "bench strings");
+		BenchmarkStrings(&bench_arena);
+		ArenaStatsDump();
+		return 0;
+	}
+
+	if (cmd_line && wcsncmp(cmd_line, L"--bench-numbers", 15) == 0) {
+		MemoryArena bench_arena = {};
+		u32 bench_memory_size = MegaBytes(64);
+		InitializeArena(&bench_arena, bench_memory_size, (u8*)ReserveAndCommitPage(0, bench_memory_size / PAGE_SIZE));
+		ArenaRegister(&bench_arena, "bench numbers");
+		BenchmarkNumbers(&bench_arena);
+		ArenaStatsDump();
+		return 0;
+	}
+
 	char* filename = "test_script.cos";
+	if (cmd_line && wcsncmp(cmd_line, L"--watch-rules", 13) == 0) {
+		MemoryArena watch_arena = {};
+		u32 watch_memory_size = MegaBytes(64);
+		InitializeArena(&watch_arena, watch_memory_size, (u8*)ReserveAndCommitPage(0, watch_memory_size / PAGE_SIZE));
+		ArenaRegister(&watch_arena, "watch");
+		WatchRules(&watch_arena, filename);
+		return 0;
+	}
+
+	if (cmd_line && wcsncmp(cmd_line, L"--profile-rules", 15) == 0) {
+		MemoryArena profile_arena = {};
+		u32 profile_memory_size = MegaBytes(16);
+		InitializeArena(&profile_arena, profile_memory_size, (u8*)ReserveAndCommitPage(0, profile_memory_size / PAGE_SIZE));
+		ArenaRegister(&profile_arena, "profile");
+		ProfileRules(&profile_arena, filename);
+		return 0;
+	}
+
 	DebugReadFileResult file = DebugPlatformReadEntireFile(filename);
 	
-	u8* memory = (u8*)ReserveAndCommitPage(0, 4);
+	u8* memory = (u8*)ReserveAndCommitPage(0, 64);
 	MemoryArena arena = {};
-	InitializeArena(&arena, PAGE_SIZE*4, memory);
+	InitializeArena(&arena, PAGE_SIZE*64, memory);
+	ArenaRegister(&arena, "script");
+	ConditionRegistryInit(&condition_registry, &arena, 256);
+	LoadConditionsFile(&condition_registry, "conditions.txt");
 	VM vm = {};
-	InitVM(&vm);
+	InitVM(&vm, &condition_tables);
+	CompileOptions options = {};
+	options.registry = &condition_registry;
 	u8* src = (u8*)"(-1 + 2) * 3 - -4";
-	Interpret(&vm, &arena, (u8*)src);
+	Interpret(&vm, &arena, (u8*)src, &options);
 
 	DDEBUGN("\n");
 	return 0;
-}
\ No newline at end of file
+}
+
+#define LOG_ARENA_SIZE MegaBytes(4)
+
+static int Run(wchar_t* cmd_line) {
+	MemoryArena log_arena = {};
+	if (InitializeGrowingArena(&log_arena, LOG_ARENA_SIZE, KiloBytes(64))) {
+		ArenaRegister(&log_arena, "log");
+		StartLogWriter(&log_arena);
+	}
+	int result = RunMode(cmd_line);
+	StopLogWriter();
+	return result;
+}
+
+#if DPLATFORM_WINDOWS
+int WINAPI wWinMain(HINSTANCE instance, HINSTANCE prev_instance, PWSTR cmd_line, int cmd_show) {
+	return Run(cmd_line);
+}
+#else
+#define MODE_ARG_LENGTH 64
+
+//NOTE: only the first argument picks a mode, widened so RunMode sees what wWinMain would get
+int main(int argc, char** argv) {
+	wchar_t mode[MODE_ARG_LENGTH] = {};
+	if (argc > 1 && mbstowcs(mode, argv[1], MODE_ARG_LENGTH - 1) == (size_t)-1) {
+		mode[0] = 0;
+	}
+	return Run(mode);
+}
+#endif
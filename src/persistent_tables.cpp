@@ -0,0 +1,148 @@
+#include "persistent_tables.h"
+
+static u64 RoundUpToPage(u64 size) {
+	return (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+}
+
+static PersistentTableRegion PersistentRegionAfter(PersistentTableRegion previous, u64 size) {
+	PersistentTableRegion result = {};
+	result.offset = previous.offset + previous.size;
+	result.size = RoundUpToPage(size);
+	return result;
+}
+
+static void PersistentTablesLayout(PersistentTablesHeader* layout, PersistentTableSizes* sizes) {
+	layout->magic = PERSISTENT_TABLES_MAGIC;
+	layout->version = PERSISTENT_TABLES_VERSION;
+	layout->bools = {0, RoundUpToPage(sizeof(PersistentTablesHeader)), 0};
+	layout->bools = PersistentRegionAfter(layout->bools, sizes->bools);
+	layout->chars = PersistentRegionAfter(layout->bools, sizes->chars);
+	layout->floats = PersistentRegionAfter(layout->chars, sizes->floats);
+	layout->string_look_aside = PersistentRegionAfter(layout->floats, sizes->string_look_aside);
+	layout->strings = PersistentRegionAfter(layout->string_look_aside, sizes->strings);
+	layout->ints = PersistentRegionAfter(layout->strings, sizes->ints);
+}
+
+static u64 PersistentTablesFileSize(PersistentTablesHeader* layout) {
+	return layout->ints.offset + layout->ints.size;
+}
+
+static void PersistentTablesPointTables(PersistentTables* persistent) {
+	PersistentTablesHeader* header = persistent->header;
+	ConditionTables* tables = persistent->tables;
+	u8* base = persistent->file.memory;
+	tables->bool_table->InitWithMemory(base + header->bools.offset, header->bools.size, header->bools.used);
+	tables->char_table->InitWithMemory(base + header->chars.offset, header->chars.size, header->chars.used);
+	tables->float_table->InitWithMemory(base + header->floats.offset, header->floats.size, header->floats.used);
+	tables->string_table->InitWithMemory(base + header->string_look_aside.offset, header->string_look_aside.size, header->string_look_aside.used,
+		base + header->strings.offset, header->strings.size, header->strings.used);
+	tables->int_table->InitWithMemory(base + header->ints.offset, header->ints.size, header->ints.used);
+}
+
+static void PersistentTablesRecordUsed(PersistentTables* persistent) {
+	PersistentTablesHeader* header = persistent->header;
+	ConditionTables* tables = persistent->tables;
+	header->bools.used = tables->bool_table->memory.used;
+	header->chars.used = tables->char_table->memory.used;
+	header->floats.used = tables->float_table->memory.used;
+	header->string_look_aside.used = tables->string_table->look_aside_memory.used;
+	header->strings.used = tables->string_table->conditions_memory.used;
+	header->ints.used = tables->int_table->memory.used;
+}
+
+//NOTE: maps the file and points the tables straight at it. A new file gets laid out from sizes,
+//an existing one keeps its own layout and its conditions are live again as soon as it is mapped.
+//Pages are only read in from disk when a condition on them is touched.
+//The tables can't grow past their regions on their own, see PersistentTablesReserve.
+b32 PersistentTablesOpen(PersistentTables* persistent, char* filename, PersistentTableSizes* sizes, ConditionTables* tables) {
+	PersistentTablesHeader layout = {};
+	PersistentTablesLayout(&layout, sizes);
+
+	if (!PlatformMapFile(filename, PersistentTablesFileSize(&layout), &persistent->file)) {
+		DERROR("PersistentTablesOpen - could not map %s", filename);
+		return false;
+	}
+	PersistentTablesHeader* header = (PersistentTablesHeader*)persistent->file.memory;
+	if (persistent->file.created) {
+		*header = layout;
+	} else if (header->magic != PERSISTENT_TABLES_MAGIC || header->version != PERSISTENT_TABLES_VERSION) {
+		DERROR("PersistentTablesOpen - %s is not a condition table file", filename);
+		PlatformUnmapFile(&persistent->file);
+		return false;
+	}
+	persistent->header = header;
+	persistent->tables = tables;
+	persistent->filename = filename;
+	PersistentTablesPointTables(persistent);
+	return true;
+}
+
+//NOTE: makes sure every table has room for extra more bytes, growing the file when one doesn't. A region
+//that is too small at least doubles and every region after it moves up, so the tables can end up
+//somewhere else in memory. Nothing that points into the tables survives a call that grows the file.
+b32 PersistentTablesReserve(PersistentTables* persistent, PersistentTableSizes* extra) {
+	PersistentTablesRecordUsed(persistent);
+	PersistentTablesHeader old_layout = *persistent->header;
+	PersistentTableRegion* old_regions = &old_layout.bools;
+	u64* extra_sizes = &extra->bools;
+	PersistentTableSizes new_sizes;
+	u64* sizes = &new_sizes.bools;
+	b32 grow = false;
+	for (u32 i = 0; i < PERSISTENT_TABLE_REGIONS; i++) {
+		u64 needed = old_regions[i].used + extra_sizes[i];
+		sizes[i] = old_regions[i].size;
+		if (needed > old_regions[i].size) {
+			sizes[i] = Maximum(old_regions[i].size * 2, needed);
+			grow = true;
+		}
+	}
+	if (!grow) {
+		return true;
+	}
+
+	PersistentTablesHeader layout = {};
+	PersistentTablesLayout(&layout, &new_sizes);
+	layout.conditions_hash = old_layout.conditions_hash;
+	layout.condition_count = old_layout.condition_count;
+	PlatformUnmapFile(&persistent->file);
+	if (!PlatformMapFile(persistent->filename, PersistentTablesFileSize(&layout), &persistent->file)) {
+		DERROR("PersistentTablesReserve - could not grow %s", persistent->filename);
+		*persistent = {};
+		return false;
+	}
+	//NOTE: regions only ever move up, so moving the last one first never overwrites one still to move
+	u8* base = persistent->file.memory;
+	PersistentTableRegion* regions = &layout.bools;
+	for (u32 i = PERSISTENT_TABLE_REGIONS; i-- > 0;) {
+		regions[i].used = old_regions[i].used;
+		MemMove(base + old_regions[i].offset, base + regions[i].offset, old_regions[i].used);
+	}
+	persistent->header = (PersistentTablesHeader*)base;
+	*persistent->header = layout;
+	PersistentTablesPointTables(persistent);
+	return PlatformFlushMappedFile(&persistent->file);
+}
+
+//NOTE: drops every condition, the file keeps its size
+void PersistentTablesClear(PersistentTables* persistent) {
+	persistent->header->conditions_hash = 0;
+	persistent->header->condition_count = 0;
+	PersistentTableRegion* regions = &persistent->header->bools;
+	for (u32 i = 0; i < PERSISTENT_TABLE_REGIONS; i++) {
+		regions[i].used = 0;
+	}
+	PersistentTablesPointTables(persistent);
+}
+
+//NOTE: values are already in the mapping, a checkpoint records how much of each table is in use and
+//has the OS write back the dirty pages
+b32 PersistentTablesCheckpoint(PersistentTables* persistent) {
+	PersistentTablesRecordUsed(persistent);
+	return PlatformFlushMappedFile(&persistent->file);
+}
+
+void PersistentTablesClose(PersistentTables* persistent) {
+	PersistentTablesCheckpoint(persistent);
+	PlatformUnmapFile(&persistent->file);
+	*persistent = {};
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#define PERSISTENT_TABLES_MAGIC 0x53444E43u //"CNDS"
+#define PERSISTENT_TABLES_VERSION 4
+//NOTE: the regions in the header and the sizes are walked as arrays in this order
+#define PERSISTENT_TABLE_REGIONS 6
+
+//NOTE: where a table's memory sits in the file, everything is an offset from the start of the mapping
+struct PersistentTableRegion {
+	u64 offset;
+	u64 size;
+	u64 used;
+};
+
+struct PersistentTablesHeader {
+	u32 magic;
+	u32 version;
+	//NOTE: which conditions were created in the tables, 0 until something records them
+	u32 conditions_hash;
+	u32 condition_count;
+	PersistentTableRegion bools;
+	PersistentTableRegion chars;
+	PersistentTableRegion floats;
+	PersistentTableRegion string_look_aside;
+	PersistentTableRegion strings;
+	PersistentTableRegion ints;
+};
+
+struct PersistentTableSizes {
+	u64 bools;
+	u64 chars;
+	u64 floats;
+	u64 string_look_aside;
+	u64 strings;
+	u64 ints;
+};
+
+STATIC_ASSERT(sizeof(PersistentTablesHeader) == 4 * sizeof(u32) + PERSISTENT_TABLE_REGIONS * sizeof(PersistentTableRegion), "regions have to be back to back");
+STATIC_ASSERT(sizeof(PersistentTableSizes) == PERSISTENT_TABLE_REGIONS * sizeof(u64), "sizes has to be one u64 per region");
+
+struct PersistentTables {
+	MappedFile file;
+	char* filename;
+	PersistentTablesHeader* header;
+	ConditionTables* tables;
+};
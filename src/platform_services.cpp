@@ -1,19 +1,546 @@
 #include "platform_services.h"
+#if !DPLATFORM_WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+#endif
 
-#define PAGE_SIZE KiloBytes(4)
+//NOTE: writes every page so it's backed now, reading would only map the shared zero page
+static void PrefaultPages(u8* pages, u64 size) {
+	for (u64 offset = 0; offset < size; offset += PAGE_SIZE) {
+		volatile u8* touch = pages + offset;
+		*touch = *touch;
+	}
+}
 
+#if DPLATFORM_WINDOWS
 void* ReservePage(void* base_address, u32 page_count) {
-	return VirtualAlloc(base_address, page_count*PAGE_SIZE, MEM_RESERVE, PAGE_NOACCESS);
+	return VirtualAlloc(base_address, (SIZE_T)page_count*PAGE_SIZE, MEM_RESERVE, PAGE_NOACCESS);
 }
 
 void* CommitPage(void* base_address, u32 page_count) {
-	return VirtualAlloc(base_address, page_count*PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE);
+	return VirtualAlloc(base_address, (SIZE_T)page_count*PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE);
 }
 
 void* ReserveAndCommitPage(void* base_address, u32 page_count) {
-	return VirtualAlloc(base_address, page_count*PAGE_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+	return VirtualAlloc(base_address, (SIZE_T)page_count*PAGE_SIZE, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+}
+
+void DecommitPage(void* base_address, u32 page_count) {
+	VirtualFree(base_address, (SIZE_T)page_count*PAGE_SIZE, MEM_DECOMMIT);
+}
+
+void ReleasePage(void* base_address, u32 page_count) {
+	VirtualFree(base_address, 0, MEM_RELEASE);
+}
+
+//NOTE: large pages need SeLockMemoryPrivilege and are always resident, so there is nothing to prefault
+void* ReserveAndCommitPages(void* base_address, u64 size, u32 page_flags) {
+	if (page_flags & (PAGE_FLAG_HUGE|PAGE_FLAG_HUGE_EXPLICIT)) {
+		u64 large_page_size = GetLargePageMinimum();
+		if (large_page_size) {
+			u64 large_size = (size + large_page_size - 1) / large_page_size * large_page_size;
+			void* pages = VirtualAlloc(base_address, large_size, MEM_COMMIT|MEM_RESERVE|MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (pages) {
+				return pages;
+			}
+		}
+	}
+	size = (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+	u8* pages = (u8*)VirtualAlloc(base_address, size, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+	if (pages && (page_flags & PAGE_FLAG_PREFAULT)) {
+		PrefaultPages(pages, size);
+	}
+	return pages;
+}
+#else
+//NOTE: like VirtualAlloc a base address is where the pages have to go, not a hint
+static void* MapPages(void* base_address, u64 size, i32 protection, i32 flags) {
+#if defined(MAP_FIXED_NOREPLACE)
+	if (base_address) {
+		flags |= MAP_FIXED_NOREPLACE;
+	}
+#endif
+	void* pages = mmap(base_address, size, protection, MAP_PRIVATE|MAP_ANONYMOUS|flags, -1, 0);
+	if (pages == MAP_FAILED) {
+		return 0;
+	}
+	if (base_address && pages != base_address) {
+		munmap(pages, size);
+		return 0;
+	}
+	return pages;
+}
+
+//NOTE: reserved pages don't count against the commit limit until CommitPage makes them writable
+void* ReservePage(void* base_address, u32 page_count) {
+	return MapPages(base_address, (u64)page_count*PAGE_SIZE, PROT_NONE, MAP_NORESERVE);
+}
+
+//NOTE: same as VirtualAlloc with MEM_COMMIT, a null base commits fresh pages and an unaligned base
+//commits every page the range touches
+void* CommitPage(void* base_address, u32 page_count) {
+	if (!base_address) {
+		return ReserveAndCommitPage(0, page_count);
+	}
+	uintptr_t start = (uintptr_t)base_address & ~((uintptr_t)PAGE_SIZE - 1);
+	uintptr_t end = (uintptr_t)base_address + (u64)page_count*PAGE_SIZE;
+	end = (end + PAGE_SIZE - 1) & ~((uintptr_t)PAGE_SIZE - 1);
+	if (mprotect((void*)start, end - start, PROT_READ|PROT_WRITE) != 0) {
+		return 0;
+	}
+	return (void*)start;
+}
+
+void* ReserveAndCommitPage(void* base_address, u32 page_count) {
+	return MapPages(base_address, (u64)page_count*PAGE_SIZE, PROT_READ|PROT_WRITE, 0);
+}
+
+//NOTE: mapping fresh inaccessible pages over the range drops the old ones and their commit charge
+void DecommitPage(void* base_address, u32 page_count) {
+	mmap(base_address, (u64)page_count*PAGE_SIZE, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE|MAP_FIXED, -1, 0);
+}
+
+void ReleasePage(void* base_address, u32 page_count) {
+	munmap(base_address, (u64)page_count*PAGE_SIZE);
+}
+
+//NOTE: transparent huge pages only back 2MB aligned ranges, so without a base the range is
+//over-mapped and trimmed to an aligned start. MAP_POPULATE would fault in small pages before the
+//huge page advice lands, so huge ranges are prefaulted after it.
+void* ReserveAndCommitPages(void* base_address, u64 size, u32 page_flags) {
+	b32 huge = page_flags & (PAGE_FLAG_HUGE|PAGE_FLAG_HUGE_EXPLICIT);
+	b32 prefault = page_flags & PAGE_FLAG_PREFAULT;
+	if (!huge) {
+		size = (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+#if defined(MAP_POPULATE)
+		return MapPages(base_address, size, PROT_READ|PROT_WRITE, prefault ? MAP_POPULATE : 0);
+#else
+		u8* pages = (u8*)MapPages(base_address, size, PROT_READ|PROT_WRITE, 0);
+		if (pages && prefault) {
+			PrefaultPages(pages, size);
+		}
+		return pages;
+#endif
+	}
+
+	size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+#if defined(MAP_HUGETLB)
+	if (page_flags & PAGE_FLAG_HUGE_EXPLICIT) {
+		//NOTE: fails when /proc/sys/vm/nr_hugepages hasn't set enough aside
+		void* pages = MapPages(base_address, size, PROT_READ|PROT_WRITE, MAP_HUGETLB|(prefault ? MAP_POPULATE : 0));
+		if (pages) {
+			return pages;
+		}
+	}
+#endif
+	u8* pages;
+	if (base_address) {
+		pages = (u8*)MapPages(base_address, size, PROT_READ|PROT_WRITE, 0);
+	}
+	else {
+		u8* mapped = (u8*)MapPages(0, size + HUGE_PAGE_SIZE, PROT_READ|PROT_WRITE, 0);
+		if (!mapped) {
+			return 0;
+		}
+		pages = (u8*)(((uintptr_t)mapped + HUGE_PAGE_SIZE - 1) & ~((uintptr_t)HUGE_PAGE_SIZE - 1));
+		if (pages > mapped) {
+			munmap(mapped, pages - mapped);
+		}
+		u8* mapped_end = mapped + size + HUGE_PAGE_SIZE;
+		if (mapped_end > pages + size) {
+			munmap(pages + size, mapped_end - (pages + size));
+		}
+	}
+	if (!pages) {
+		return 0;
+	}
+#if defined(MADV_HUGEPAGE)
+	madvise(pages, size, MADV_HUGEPAGE);
+#endif
+	if (prefault) {
+#if defined(MADV_POPULATE_WRITE)
+		if (madvise(pages, size, MADV_POPULATE_WRITE) != 0) {
+			PrefaultPages(pages, size);
+		}
+#else
+		PrefaultPages(pages, size);
+#endif
+	}
+	return pages;
+}
+#endif
+
+#if DPLATFORM_WINDOWS
+//NOTE: grows the file to size if it is smaller, created is set when the file was empty
+b32 PlatformMapFile(char* filename, u64 size, MappedFile* result) {
+	*result = {};
+	result->file_handle = CreateFileA(filename, GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (result->file_handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(result->file_handle, &file_size);
+	result->created = file_size.QuadPart == 0;
+	if ((u64)file_size.QuadPart > size) {
+		size = file_size.QuadPart;
+	}
+	result->mapping_handle = CreateFileMappingA(result->file_handle, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+	if (!result->mapping_handle) {
+		CloseHandle(result->file_handle);
+		return false;
+	}
+	result->memory = (u8*)MapViewOfFile(result->mapping_handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	if (!result->memory) {
+		CloseHandle(result->mapping_handle);
+		CloseHandle(result->file_handle);
+		return false;
+	}
+	result->size = size;
+	return true;
+}
+
+//NOTE: for reading large inputs front to back, pages come in as they are touched
+b32 PlatformMapFileReadOnly(char* filename, MappedFile* result) {
+	*result = {};
+	result->file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (result->file_handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER file_size;
+	GetFileSizeEx(result->file_handle, &file_size);
+	if (file_size.QuadPart == 0) {
+		return true;
+	}
+	result->mapping_handle = CreateFileMappingA(result->file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!result->mapping_handle) {
+		CloseHandle(result->file_handle);
+		return false;
+	}
+	result->memory = (u8*)MapViewOfFile(result->mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	if (!result->memory) {
+		CloseHandle(result->mapping_handle);
+		CloseHandle(result->file_handle);
+		return false;
+	}
+	result->size = file_size.QuadPart;
+	return true;
+}
+
+//NOTE: only dirty pages get written back
+b32 PlatformFlushMappedFile(MappedFile* file) {
+	return FlushViewOfFile(file->memory, 0) && FlushFileBuffers(file->file_handle);
+}
+
+void PlatformUnmapFile(MappedFile* file) {
+	if (file->memory) {
+		UnmapViewOfFile(file->memory);
+		CloseHandle(file->mapping_handle);
+	}
+	CloseHandle(file->file_handle);
+	*file = {};
+}
+#else
+b32 PlatformMapFile(char* filename, u64 size, MappedFile* result) {
+	*result = {};
+	result->fd = open(filename, O_RDWR|O_CREAT, 0644);
+	if (result->fd < 0) {
+		return false;
+	}
+	struct stat file_stat;
+	fstat(result->fd, &file_stat);
+	result->created = file_stat.st_size == 0;
+	if ((u64)file_stat.st_size > size) {
+		size = file_stat.st_size;
+	} else if (ftruncate(result->fd, size) != 0) {
+		close(result->fd);
+		return false;
+	}
+	void* memory = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, result->fd, 0);
+	if (memory == MAP_FAILED) {
+		close(result->fd);
+		return false;
+	}
+	result->memory = (u8*)memory;
+	result->size = size;
+	return true;
+}
+
+b32 PlatformMapFileReadOnly(char* filename, MappedFile* result) {
+	*result = {};
+	result->fd = open(filename, O_RDONLY);
+	if (result->fd < 0) {
+		return false;
+	}
+	struct stat file_stat;
+	fstat(result->fd, &file_stat);
+	if (file_stat.st_size == 0) {
+		return true;
+	}
+	void* memory = mmap(0, file_stat.st_size, PROT_READ, MAP_PRIVATE, result->fd, 0);
+	if (memory == MAP_FAILED) {
+		close(result->fd);
+		return false;
+	}
+	madvise(memory, file_stat.st_size, MADV_SEQUENTIAL);
+	result->memory = (u8*)memory;
+	result->size = file_stat.st_size;
+	return true;
 }
 
+b32 PlatformFlushMappedFile(MappedFile* file) {
+	return msync(file->memory, file->size, MS_SYNC) == 0;
+}
+
+void PlatformUnmapFile(MappedFile* file) {
+	if (file->memory) {
+		munmap(file->memory, file->size);
+	}
+	close(file->fd);
+	*file = {};
+}
+#endif
+
+#if DPLATFORM_WINDOWS
+f64 PlatformGetSeconds() {
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (f64)counter.QuadPart / (f64)frequency.QuadPart;
+}
+
+u32 PlatformNumaNodeCount() {
+	ULONG highest_node = 0;
+	if (!GetNumaHighestNodeNumber(&highest_node)) {
+		return 1;
+	}
+	return highest_node + 1;
+}
+
+b32 PlatformPinThreadToNumaNode(u32 node) {
+	GROUP_AFFINITY affinity = {};
+	if (!GetNumaNodeProcessorMaskEx((USHORT)node, &affinity)) {
+		return false;
+	}
+	return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL);
+}
+
+//NOTE: base_address has to be inside a range already reserved with ReservePage
+void* PlatformCommitPageOnNumaNode(void* base_address, u32 page_count, u32 node) {
+	return VirtualAllocExNuma(GetCurrentProcess(), base_address, (SIZE_T)page_count*PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE, node);
+}
+
+static b32 GetLastWriteTime(char* filename, FILETIME* last_write) {
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &data)) {
+		return false;
+	}
+	*last_write = data.ftLastWriteTime;
+	return true;
+}
+
+b32 PlatformWatchFile(char* filename, FileWatch* watch) {
+	*watch = {};
+	char directory[MAX_PATH];
+	char* separator = 0;
+	for (char* c = filename; *c; c++) {
+		if (*c == '\\' || *c == '/') {
+			separator = c;
+		}
+	}
+	if (separator) {
+		u32 length = (u32)(separator - filename);
+		if (length >= MAX_PATH) {
+			return false;
+		}
+		memcpy(directory, filename, length);
+		directory[length] = 0;
+	}
+	else {
+		directory[0] = '.';
+		directory[1] = 0;
+	}
+	watch->filename = filename;
+	GetLastWriteTime(filename, &watch->last_write);
+	watch->change_handle = FindFirstChangeNotificationA(directory, FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE|FILE_NOTIFY_CHANGE_FILE_NAME);
+	return watch->change_handle != INVALID_HANDLE_VALUE;
+}
+
+//NOTE: the notification is for the whole directory, the write time tells if it was this file
+b32 PlatformFileChanged(FileWatch* watch) {
+	if (WaitForSingleObject(watch->change_handle, 0) != WAIT_OBJECT_0) {
+		return false;
+	}
+	FindNextChangeNotification(watch->change_handle);
+	FILETIME last_write;
+	if (!GetLastWriteTime(watch->filename, &last_write) || CompareFileTime(&last_write, &watch->last_write) == 0) {
+		return false;
+	}
+	watch->last_write = last_write;
+	return true;
+}
+
+void PlatformUnwatchFile(FileWatch* watch) {
+	FindCloseChangeNotification(watch->change_handle);
+	*watch = {};
+}
+#else
+f64 PlatformGetSeconds() {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (f64)now.tv_sec + (f64)now.tv_nsec / 1000000000.0;
+}
+
+u32 PlatformNumaNodeCount() {
+	u32 node_count = 0;
+	char path[64];
+	for (;;) {
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%u", node_count);
+		if (access(path, F_OK) != 0) {
+			break;
+		}
+		node_count++;
+	}
+	return node_count > 0 ? node_count : 1;
+}
+
+//NOTE: cpulist is ranges like "0-3,8-11"
+b32 PlatformPinThreadToNumaNode(u32 node) {
+#if defined(__linux__)
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		return false;
+	}
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	u32 first, last;
+	i32 matched;
+	while ((matched = fscanf(file, "%u-%u", &first, &last)) >= 1) {
+		if (matched == 1) {
+			last = first;
+		}
+		for (u32 cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+			CPU_SET(cpu, &cpus);
+		}
+		if (fgetc(file) != ',') {
+			break;
+		}
+	}
+	fclose(file);
+	return CPU_COUNT(&cpus) > 0 && sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+#else
+	return false;
+#endif
+}
+
+//NOTE: no libnuma, pages land on the node of the thread that first writes them, so this has to be
+//called from a thread pinned to node. Every page is written here so placement doesn't wait for first use.
+void* PlatformCommitPageOnNumaNode(void* base_address, u32 page_count, u32 node) {
+	u8* pages = (u8*)CommitPage(base_address, page_count);
+	if (!pages) {
+		return 0;
+	}
+	PrefaultPages(pages, (u64)page_count * PAGE_SIZE);
+	return pages;
+}
+
+static i64 GetLastWriteTime(char* filename) {
+	struct stat info;
+	if (stat(filename, &info) != 0) {
+		return 0;
+	}
+	return (i64)info.st_mtime;
+}
+
+//NOTE: without inotify this falls back to polling the modified time, which only has second resolution
+b32 PlatformWatchFile(char* filename, FileWatch* watch) {
+	*watch = {};
+	watch->fd = -1;
+	watch->filename = filename;
+	watch->last_modified = GetLastWriteTime(filename);
+	char* name = filename;
+	for (char* c = filename; *c; c++) {
+		if (*c == '/') {
+			name = c + 1;
+		}
+	}
+	if (strlen(name) >= sizeof(watch->name)) {
+		return false;
+	}
+	strcpy(watch->name, name);
+#if defined(__linux__)
+	char directory[256];
+	u32 length = (u32)(name - filename);
+	if (length == 0) {
+		directory[0] = '.';
+		directory[1] = 0;
+	}
+	else {
+		if (length >= sizeof(directory)) {
+			return false;
+		}
+		memcpy(directory, filename, length);
+		directory[length] = 0;
+	}
+	watch->fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+	if (watch->fd < 0) {
+		return false;
+	}
+	if (inotify_add_watch(watch->fd, directory, IN_CLOSE_WRITE|IN_MOVED_TO) < 0) {
+		close(watch->fd);
+		watch->fd = -1;
+		return false;
+	}
+#endif
+	return true;
+}
+
+b32 PlatformFileChanged(FileWatch* watch) {
+#if defined(__linux__)
+	b32 changed = false;
+	alignas(inotify_event) u8 buffer[4096];
+	for (;;) {
+		ssize_t bytes = read(watch->fd, buffer, sizeof(buffer));
+		if (bytes <= 0) {
+			break;
+		}
+		for (u8* at = buffer; at < buffer + bytes;) {
+			inotify_event* event = (inotify_event*)at;
+			if (event->len > 0 && strcmp(event->name, watch->name) == 0) {
+				changed = true;
+			}
+			at += sizeof(inotify_event) + event->len;
+		}
+	}
+	return changed;
+#else
+	i64 last_modified = GetLastWriteTime(watch->filename);
+	if (last_modified == watch->last_modified) {
+		return false;
+	}
+	watch->last_modified = last_modified;
+	return true;
+#endif
+}
+
+void PlatformUnwatchFile(FileWatch* watch) {
+	if (watch->fd >= 0) {
+		close(watch->fd);
+	}
+	*watch = {};
+}
+#endif
+
+#if DPLATFORM_WINDOWS
 static DebugReadFileResult DebugPlatformReadEntireFile(char* filename) {
     DebugReadFileResult result = {};
     HANDLE file_handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, NULL, NULL);
@@ -63,3 +590,57 @@ static b32 DebugPlatformWriteEntireFile(char* filename, u32 memory_size, void* m
     }
     return result;
 }
+#else
+static DebugReadFileResult DebugPlatformReadEntireFile(char* filename) {
+    DebugReadFileResult result = {};
+    i32 fd = open(filename, O_RDONLY);
+    if (fd >= 0) {
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0) {
+            DASSERT(file_stat.st_size <= 0xFFFFFFFF);
+            u64 file_size = (u64)file_stat.st_size;
+            result.contents = malloc(file_size ? file_size : 1);
+            if (result.contents) {
+                u64 bytes_read = 0;
+                while (bytes_read < file_size) {
+                    ssize_t read_now = read(fd, (u8*)result.contents + bytes_read, file_size - bytes_read);
+                    if (read_now <= 0) {
+                        break;
+                    }
+                    bytes_read += read_now;
+                }
+                if (bytes_read == file_size) {
+                    result.contents_size = (u32)file_size;
+                } else {
+                    DebugPlatformFreeFileMemory(result.contents);
+                    result.contents = 0;
+                }
+            }
+        }
+        close(fd);
+    }
+    return result;
+}
+
+static void DebugPlatformFreeFileMemory(void* memory) {
+    free(memory);
+}
+
+static b32 DebugPlatformWriteEntireFile(char* filename, u32 memory_size, void* memory) {
+    b32 result = false;
+    i32 fd = open(filename, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (fd >= 0) {
+        u64 bytes_written = 0;
+        while (bytes_written < memory_size) {
+            ssize_t written_now = write(fd, (u8*)memory + bytes_written, memory_size - bytes_written);
+            if (written_now <= 0) {
+                break;
+            }
+            bytes_written += written_now;
+        }
+        result = bytes_written == memory_size;
+        close(fd);
+    }
+    return result;
+}
+#endif
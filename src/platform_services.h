@@ -1,4 +1,11 @@
 #pragma once
+#if DPLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <stdlib.h>
+#endif
+
+#define PAGE_SIZE KiloBytes(4)
 
 void* ReservePage(void* base_address, u32 page_count);
 
@@ -6,6 +13,76 @@ void* CommitPage(void* base_address, u32 page_count);
 
 void* ReserveAndCommitPage(void* base_address, u32 page_count);
 
+//NOTE: hands the physical pages back, the range stays reserved and can be committed again
+void DecommitPage(void* base_address, u32 page_count);
+
+//NOTE: gives back a whole range from ReservePage or ReserveAndCommitPage, base_address has to be its start
+void ReleasePage(void* base_address, u32 page_count);
+
+#define HUGE_PAGE_SIZE MegaBytes(2)
+
+//NOTE: for memory whose size is known up front. Both huge page flags fall back to normal pages when
+//the system won't give out huge ones.
+enum PageFlags {
+    PAGE_FLAGS_NONE = 0,
+    PAGE_FLAG_HUGE = 1 << 0,          //transparent huge pages on Linux, large pages on Windows
+    PAGE_FLAG_HUGE_EXPLICIT = 1 << 1, //pages from the reserved hugetlb pool on Linux
+    PAGE_FLAG_PREFAULT = 1 << 2       //fault every page in now rather than on first touch
+};
+
+void* ReserveAndCommitPages(void* base_address, u64 size, u32 page_flags);
+
+//NOTE: a file mapped read/write and shared, so writes to memory land in the file
+struct MappedFile {
+    u8* memory;
+    u64 size;
+    b32 created;
+#if DPLATFORM_WINDOWS
+    HANDLE file_handle;
+    HANDLE mapping_handle;
+#else
+    i32 fd;
+#endif
+};
+
+b32 PlatformMapFile(char* filename, u64 size, MappedFile* result);
+
+b32 PlatformMapFileReadOnly(char* filename, MappedFile* result);
+
+b32 PlatformFlushMappedFile(MappedFile* file);
+
+void PlatformUnmapFile(MappedFile* file);
+
+f64 PlatformGetSeconds();
+
+//NOTE: watches the file's directory rather than the file, so editors that save by renaming a new file
+//over the old one are still seen
+struct FileWatch {
+#if DPLATFORM_WINDOWS
+    HANDLE change_handle;
+    FILETIME last_write;
+    char* filename;
+#else
+    i32 fd;
+    char name[256];
+    i64 last_modified;
+    char* filename;
+#endif
+};
+
+b32 PlatformWatchFile(char* filename, FileWatch* watch);
+
+//NOTE: doesn't block, true once for each time the file was written since the last call
+b32 PlatformFileChanged(FileWatch* watch);
+
+void PlatformUnwatchFile(FileWatch* watch);
+
+u32 PlatformNumaNodeCount();
+
+b32 PlatformPinThreadToNumaNode(u32 node);
+
+void* PlatformCommitPageOnNumaNode(void* base_address, u32 page_count, u32 node);
+
 struct DebugReadFileResult {
     u32 contents_size;
     void* contents;
@@ -18,5 +95,9 @@ static void DebugPlatformFreeFileMemory(void* memory);
 static b32 DebugPlatformWriteEntireFile(char* filename, u32 memory_size, void* memory);
 
 void Exit(u32 code) {
+#if DPLATFORM_WINDOWS
     ExitProcess(code);
+#else
+    exit((i32)code);
+#endif
 }
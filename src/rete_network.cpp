@@ -0,0 +1,225 @@
+#include "rete_network.h"
+
+static u32 HashConditionRef(ConditionRef condition) {
+	u32 hash = HashBytes(&condition.table, sizeof(condition.table));
+	return HashBytes(&condition.id, sizeof(condition.id), hash);
+}
+
+//NOTE: ints and floats hash as the f64 ValuesEqual compares them as, so x == 1 and x == 1.0 share a node
+static u32 HashConditionTest(ConditionTest* test) {
+	u32 hash = HashConditionRef(test->condition);
+	hash = HashBytes(&test->op, sizeof(test->op), hash);
+	switch (test->constant.type) {
+		case VAL_BOOL:   hash = HashBytes(&test->constant.boolean, sizeof(b32), hash); break;
+		case VAL_NUMBER:
+		case VAL_INT: {
+			f64 number = AsNumeric(test->constant);
+			if (number == 0.0) {
+				number = 0.0; //-0.0 equals 0.0 but doesn't hash like it
+			}
+			hash = HashBytes(&number, sizeof(f64), hash);
+		} break;
+		case VAL_STRING: hash = HashBytes(test->constant.string, test->constant.length, hash); break;
+		default: break;
+	}
+	return hash;
+}
+
+static b8 ConditionTestsEqual(ConditionTest* a, ConditionTest* b) {
+	return ConditionRefsEqual(a->condition, b->condition) && a->op == b->op && ValuesEqual(a->constant, b->constant);
+}
+
+b8 EvaluateConditionTest(ConditionTest* test, Value value) {
+	switch (test->op) {
+		case TEST_EQUAL:         return ValuesEqual(value, test->constant);
+		case TEST_NOT_EQUAL:     return !ValuesEqual(value, test->constant);
+		case TEST_LESS:          return IsNumeric(value) && CompareNumbers(value, test->constant) < 0;
+		case TEST_LESS_EQUAL:    return IsNumeric(value) && CompareNumbers(value, test->constant) <= 0;
+		case TEST_GREATER:       return IsNumeric(value) && CompareNumbers(value, test->constant) > 0;
+		case TEST_GREATER_EQUAL: return IsNumeric(value) && CompareNumbers(value, test->constant) >= 0;
+	}
+	return false;
+}
+
+//NOTE: capacities are fixed up front, lookup tables are kept at 2x so probing stays short. The network
+//attaches itself to the tables, from then on every write to them is matched as it happens.
+void ReteInit(ReteNetwork* net, MemoryArena* arena, ConditionTables* tables, u32 max_tests, u32 max_rules, u32 max_edges) {
+	net->tables = tables;
+	if (tables->bool_table) tables->bool_table->network = net;
+	if (tables->char_table) tables->char_table->network = net;
+	if (tables->float_table) tables->float_table->network = net;
+	if (tables->string_table) tables->string_table->network = net;
+	if (tables->int_table) tables->int_table->network = net;
+
+	net->alphas = PushArray(arena, max_tests, AlphaNode);
+	net->alpha_count = 0;
+	net->alpha_capacity = max_tests;
+	net->alpha_lookup_capacity = RoundUpPowOf2(max_tests * 2);
+	net->alpha_lookup = PushArray(arena, net->alpha_lookup_capacity, u32);
+	net->condition_capacity = net->alpha_lookup_capacity;
+	net->conditions = PushArray(arena, net->condition_capacity, ConditionBucket);
+	for (u32 i = 0; i < net->alpha_lookup_capacity; i++) {
+		net->alpha_lookup[i] = INVALID_ID;
+		net->conditions[i].first_alpha = INVALID_ID;
+	}
+
+	net->edges = PushArray(arena, max_edges, ReteEdge);
+	net->edge_count = 0;
+	net->edge_capacity = max_edges;
+
+	net->betas = PushArray(arena, max_rules, BetaNode);
+	net->beta_count = 0;
+	net->beta_capacity = max_rules;
+
+	QueueInit(arena, &net->activations, RoundUpPowOf2(max_rules));
+}
+
+static ConditionBucket* ReteFindCondition(ReteNetwork* net, ConditionRef condition) {
+	u32 mask = net->condition_capacity - 1;
+	u32 slot = HashConditionRef(condition) & mask;
+	for (;;) {
+		ConditionBucket* bucket = net->conditions + slot;
+		if (bucket->first_alpha == INVALID_ID || ConditionRefsEqual(bucket->condition, condition)) {
+			return bucket;
+		}
+		slot = (slot + 1) & mask;
+	}
+}
+
+static u32 ReteGetOrAddAlpha(ReteNetwork* net, ConditionTest* test) {
+	u32 mask = net->alpha_lookup_capacity - 1;
+	u32 slot = HashConditionTest(test) & mask;
+	while (net->alpha_lookup[slot] != INVALID_ID) {
+		u32 existing = net->alpha_lookup[slot];
+		if (ConditionTestsEqual(&net->alphas[existing].test, test)) {
+			return existing;
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	DASSERT(net->alpha_count < net->alpha_capacity);
+	u32 index = net->alpha_count++;
+	net->alpha_lookup[slot] = index;
+
+	ConditionBucket* bucket = ReteFindCondition(net, test->condition);
+	AlphaNode* alpha = net->alphas + index;
+	alpha->test = *test;
+	alpha->result = false;
+	alpha->first_edge = INVALID_ID;
+	alpha->next_on_condition = bucket->first_alpha;
+	bucket->condition = test->condition;
+	bucket->first_alpha = index;
+	return index;
+}
+
+//NOTE: a rule fires when every one of its tests passes
+void ReteAddRule(ReteNetwork* net, RuleId rule, ConditionTest* tests, u32 test_count) {
+	DASSERT(net->beta_count < net->beta_capacity);
+	u32 beta_index = net->beta_count++;
+	BetaNode* beta = net->betas + beta_index;
+	beta->rule = rule;
+	beta->test_count = 0;
+	beta->satisfied_count = 0;
+	beta->queued = false;
+
+	for (u32 i = 0; i < test_count; i++) {
+		u32 alpha_index = ReteGetOrAddAlpha(net, tests + i);
+		AlphaNode* alpha = net->alphas + alpha_index;
+		//a rule repeating the same test still only depends on it once
+		b8 already_linked = false;
+		for (u32 edge = alpha->first_edge; edge != INVALID_ID; edge = net->edges[edge].next) {
+			if (net->edges[edge].beta == beta_index) {
+				already_linked = true;
+				break;
+			}
+		}
+		if (already_linked) {
+			continue;
+		}
+		DASSERT(net->edge_count < net->edge_capacity);
+		u32 edge_index = net->edge_count++;
+		net->edges[edge_index].beta = beta_index;
+		net->edges[edge_index].next = alpha->first_edge;
+		alpha->first_edge = edge_index;
+		beta->test_count++;
+		if (alpha->result) {
+			beta->satisfied_count++;
+		}
+	}
+}
+
+static void ReteActivate(ReteNetwork* net, u32 beta_index) {
+	BetaNode* beta = net->betas + beta_index;
+	if (!beta->queued) {
+		beta->queued = true;
+		QueuePush(&net->activations, beta_index);
+	}
+}
+
+static void ReteSetAlphaResult(ReteNetwork* net, AlphaNode* alpha, b8 result) {
+	if (alpha->result == result) {
+		return;
+	}
+	alpha->result = result;
+	for (u32 edge = alpha->first_edge; edge != INVALID_ID; edge = net->edges[edge].next) {
+		BetaNode* beta = net->betas + net->edges[edge].beta;
+		if (result) {
+			beta->satisfied_count++;
+			if (beta->satisfied_count == beta->test_count) {
+				ReteActivate(net, net->edges[edge].beta);
+			}
+		} else {
+			beta->satisfied_count--;
+		}
+	}
+}
+
+//NOTE: call once after all rules are added to seed every alpha node from the current tables
+void ReteEvaluateAll(ReteNetwork* net) {
+	for (u32 i = 0; i < net->alpha_count; i++) {
+		AlphaNode* alpha = net->alphas + i;
+		Value value = QueryConditionValue(net->tables, alpha->test.condition);
+		ReteSetAlphaResult(net, alpha, EvaluateConditionTest(&alpha->test, value));
+	}
+	for (u32 i = 0; i < net->beta_count; i++) {
+		BetaNode* beta = net->betas + i;
+		if (beta->test_count == 0 || beta->satisfied_count == beta->test_count) {
+			ReteActivate(net, i);
+		}
+	}
+}
+
+//NOTE: only the alpha nodes that test this condition are re-run, and the condition is read once for all of them.
+//The attached tables call this from SetConditionValue.
+void ReteConditionChanged(ReteNetwork* net, ConditionRef condition) {
+	ConditionBucket* bucket = ReteFindCondition(net, condition);
+	if (bucket->first_alpha == INVALID_ID) {
+		return;
+	}
+	Value value = QueryConditionValue(net->tables, condition);
+	for (u32 alpha_index = bucket->first_alpha; alpha_index != INVALID_ID;) {
+		AlphaNode* alpha = net->alphas + alpha_index;
+		ReteSetAlphaResult(net, alpha, EvaluateConditionTest(&alpha->test, value));
+		alpha_index = alpha->next_on_condition;
+	}
+}
+
+b8 ReteRuleSatisfied(ReteNetwork* net, u32 beta_index) {
+	BetaNode* beta = net->betas + beta_index;
+	return beta->satisfied_count == beta->test_count;
+}
+
+//NOTE: runs every rule that became satisfied since the last call, skipping ones that went false again.
+//Conditions the rules write queue up their dependents through the tables, so this runs until nothing changes.
+u32 ReteRunActivations(ReteNetwork* net, RuleTable* rule_table) {
+	u32 rules_run = 0;
+	while (!QueueIsEmpty(&net->activations)) {
+		u32 beta_index = QueuePop(&net->activations);
+		net->betas[beta_index].queued = false;
+		if (ReteRuleSatisfied(net, beta_index)) {
+			rule_table->RunRule(net->betas[beta_index].rule);
+			rules_run++;
+		}
+	}
+	return rules_run;
+}
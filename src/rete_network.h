@@ -0,0 +1,74 @@
+#pragma once
+
+enum ConditionTestOp {
+	TEST_EQUAL,
+	TEST_NOT_EQUAL,
+	TEST_LESS,
+	TEST_LESS_EQUAL,
+	TEST_GREATER,
+	TEST_GREATER_EQUAL
+};
+
+//NOTE: a single "condition op constant" check, the unit a rule's if statement is built from
+struct ConditionTest {
+	ConditionRef condition;
+	ConditionTestOp op;
+	Value constant;
+};
+
+//NOTE: every test listed here has to pass for the rule to fire
+struct RuleConditions {
+	RuleId rule;
+	ConditionTest* tests;
+	u32 test_count;
+};
+
+//NOTE: there is one alpha node per distinct test no matter how many rules use it
+struct AlphaNode {
+	ConditionTest test;
+	b8 result;
+	u32 next_on_condition;
+	u32 first_edge;
+};
+
+struct ReteEdge {
+	u32 beta;
+	u32 next;
+};
+
+//NOTE: rules join tests over a single world state with no variable bindings, so the beta
+//join for a rule collapses to a count of how many of its alpha inputs currently pass
+struct BetaNode {
+	RuleId rule;
+	u32 test_count;
+	u32 satisfied_count;
+	b8 queued;
+};
+
+struct ConditionBucket {
+	ConditionRef condition;
+	u32 first_alpha;
+};
+
+struct ReteNetwork {
+	ConditionTables* tables;
+
+	AlphaNode* alphas;
+	u32 alpha_count;
+	u32 alpha_capacity;
+	u32* alpha_lookup;
+	u32 alpha_lookup_capacity;
+
+	ConditionBucket* conditions;
+	u32 condition_capacity;
+
+	ReteEdge* edges;
+	u32 edge_count;
+	u32 edge_capacity;
+
+	BetaNode* betas;
+	u32 beta_count;
+	u32 beta_capacity;
+
+	Queue<u32> activations;
+};
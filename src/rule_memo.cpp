@@ -0,0 +1,226 @@
+#include "rule_memo.h"
+
+//NOTE: entries are recycled least recently used first once all of them are in use
+void RuleMemoInit(RuleMemo* memo, MemoryArena* arena, ConditionTables* tables, RuleTable* rule_table, u32 max_rules, u32 max_entries) {
+	*memo = {};
+	memo->tables = tables;
+	memo->rule_table = rule_table;
+	memo->rules = PushArray(arena, max_rules, MemoRuleInputs);
+	memo->rule_capacity = max_rules;
+	for (u32 i = 0; i < max_rules; i++) {
+		memo->rules[i] = {};
+	}
+	memo->entries = PushArray(arena, max_entries, MemoEntry);
+	memo->entry_capacity = max_entries;
+	u32 bucket_count = RoundUpPowOf2(max_entries * 2);
+	memo->buckets = PushArray(arena, bucket_count, u32);
+	memo->bucket_mask = bucket_count - 1;
+	for (u32 i = 0; i < bucket_count; i++) {
+		memo->buckets[i] = INVALID_ID;
+	}
+	memo->lru_head = INVALID_ID;
+	memo->lru_tail = INVALID_ID;
+}
+
+//NOTE: opts a rule in, only do this for rules whose writes depend on nothing but inputs
+void RuleMemoAddRule(RuleMemo* memo, RuleId rule, ConditionRef* inputs, u32 input_count) {
+	DASSERT(rule < memo->rule_capacity);
+	DASSERT(input_count <= MEMO_MAX_INPUTS);
+	MemoRuleInputs* rule_inputs = memo->rules + rule;
+	for (u32 i = 0; i < input_count; i++) {
+		rule_inputs->inputs[i] = inputs[i];
+	}
+	rule_inputs->count = input_count;
+	rule_inputs->memoized = true;
+}
+
+//NOTE: a rule's guard tests name exactly the conditions it reads when its body only writes
+void RuleMemoAddRuleConditions(RuleMemo* memo, RuleConditions* conditions) {
+	ConditionRef inputs[MEMO_MAX_INPUTS];
+	u32 input_count = 0;
+	for (u32 i = 0; i < conditions->test_count; i++) {
+		ConditionRef condition = conditions->tests[i].condition;
+		b8 seen = false;
+		for (u32 j = 0; j < input_count && !seen; j++) {
+			seen = ConditionRefsEqual(inputs[j], condition);
+		}
+		if (!seen) {
+			DASSERT(input_count < MEMO_MAX_INPUTS);
+			inputs[input_count++] = condition;
+		}
+	}
+	RuleMemoAddRule(memo, conditions->rule, inputs, input_count);
+}
+
+//NOTE: false when the values don't fit in a key, the rule then just runs uncached
+static b8 PackMemoKey(RuleMemo* memo, MemoRuleInputs* rule_inputs, u8* key, u32* key_size) {
+	u32 size = 0;
+	for (u32 i = 0; i < rule_inputs->count; i++) {
+		Value value = QueryConditionValue(memo->tables, rule_inputs->inputs[i]);
+		u32 value_size;
+		void* bytes;
+		switch (value.type) {
+			case VAL_BOOL:   value_size = 1; bytes = &value.boolean; break;
+			case VAL_NUMBER: value_size = sizeof(f32); bytes = &value.number; break;
+			case VAL_INT:    value_size = sizeof(i64); bytes = &value.integer; break;
+			case VAL_STRING: value_size = AsStringLength(value); bytes = AsString(value); break;
+			default:         value_size = 0; bytes = 0; break;
+		}
+		if (size + value_size + 1 > MEMO_KEY_SIZE) {
+			return false;
+		}
+		//length first so "ab","c" and "a","bc" pack differently
+		key[size++] = (u8)value_size;
+		MemCopy(bytes, key + size, value_size);
+		size += value_size;
+	}
+	*key_size = size;
+	return true;
+}
+
+static void MemoLruUnlink(RuleMemo* memo, u32 index) {
+	MemoEntry* entry = memo->entries + index;
+	if (entry->lru_prev != INVALID_ID) {
+		memo->entries[entry->lru_prev].lru_next = entry->lru_next;
+	} else {
+		memo->lru_head = entry->lru_next;
+	}
+	if (entry->lru_next != INVALID_ID) {
+		memo->entries[entry->lru_next].lru_prev = entry->lru_prev;
+	} else {
+		memo->lru_tail = entry->lru_prev;
+	}
+}
+
+static void MemoLruPushFront(RuleMemo* memo, u32 index) {
+	MemoEntry* entry = memo->entries + index;
+	entry->lru_prev = INVALID_ID;
+	entry->lru_next = memo->lru_head;
+	if (memo->lru_head != INVALID_ID) {
+		memo->entries[memo->lru_head].lru_prev = index;
+	} else {
+		memo->lru_tail = index;
+	}
+	memo->lru_head = index;
+}
+
+static u32 MemoFind(RuleMemo* memo, RuleId rule, u32 hash, u8* key, u32 key_size) {
+	for (u32 index = memo->buckets[hash & memo->bucket_mask]; index != INVALID_ID; index = memo->entries[index].next_in_bucket) {
+		MemoEntry* entry = memo->entries + index;
+		if (entry->hash == hash && entry->rule == rule && entry->key_size == key_size && memcmp(entry->key, key, key_size) == 0) {
+			return index;
+		}
+	}
+	return INVALID_ID;
+}
+
+static void MemoRemoveFromBucket(RuleMemo* memo, u32 index) {
+	u32* link = memo->buckets + (memo->entries[index].hash & memo->bucket_mask);
+	while (*link != index) {
+		link = &memo->entries[*link].next_in_bucket;
+	}
+	*link = memo->entries[index].next_in_bucket;
+}
+
+static u32 MemoAllocEntry(RuleMemo* memo) {
+	if (memo->entry_count < memo->entry_capacity) {
+		return memo->entry_count++;
+	}
+	u32 index = memo->lru_tail;
+	MemoLruUnlink(memo, index);
+	MemoRemoveFromBucket(memo, index);
+	memo->evictions++;
+	return index;
+}
+
+static thread_local MemoEntry* memo_recording;
+
+static void MemoRecordWrite(ConditionRef condition, Value value, b8 increment) {
+	MemoEntry* entry = memo_recording;
+	if (entry->write_count == MEMO_MAX_WRITES) {
+		entry->overflowed = true;
+		return;
+	}
+	if (IsString(value)) {
+		u32 length = AsStringLength(value);
+		if (entry->strings_used + length + 1 > MEMO_STRING_BYTES) {
+			entry->overflowed = true;
+			return;
+		}
+		u8* copy = entry->strings + entry->strings_used;
+		MemCopy(AsString(value), copy, length);
+		copy[length] = '\0';
+		entry->strings_used += length + 1;
+		value = StringValN(copy, length);
+	}
+	entry->writes[entry->write_count++] = {condition, value, increment};
+}
+
+//NOTE: a hit replays the writes the rule made the last time it saw the same input values, a miss
+//runs the rule with the write hook on and caches what it wrote. A rule that wrote more than an entry
+//holds keeps its entry, marked so later runs with those inputs just run the rule.
+void RuleMemoRun(RuleMemo* memo, RuleId rule) {
+	MemoRuleInputs* rule_inputs = memo->rules + rule;
+	u8 key[MEMO_KEY_SIZE];
+	u32 key_size;
+	if (rule >= memo->rule_capacity || !rule_inputs->memoized || !PackMemoKey(memo, rule_inputs, key, &key_size)) {
+		memo->uncacheable++;
+		memo->rule_table->RunRule(rule);
+		return;
+	}
+	u32 hash = HashBytes(key, key_size, HashBytes(&rule, sizeof(rule)));
+	u32 index = MemoFind(memo, rule, hash, key, key_size);
+	if (index != INVALID_ID) {
+		MemoEntry* entry = memo->entries + index;
+		MemoLruUnlink(memo, index);
+		MemoLruPushFront(memo, index);
+		if (entry->overflowed) {
+			memo->uncacheable++;
+			memo->rule_table->RunRule(rule);
+			return;
+		}
+		memo->hits++;
+		for (u32 i = 0; i < entry->write_count; i++) {
+			MemoWrite* write = entry->writes + i;
+			if (write->increment) {
+				memo->tables->int_table->IncrementCondition((IntConditionId)write->condition.id, AsInt(write->value));
+			} else {
+				SetConditionValue(memo->tables, write->condition, write->value);
+			}
+		}
+		return;
+	}
+
+	memo->misses++;
+	index = MemoAllocEntry(memo);
+	MemoEntry* entry = memo->entries + index;
+	entry->rule = rule;
+	entry->hash = hash;
+	entry->key_size = key_size;
+	MemCopy(key, entry->key, key_size);
+	entry->write_count = 0;
+	entry->strings_used = 0;
+	entry->overflowed = false;
+
+	DASSERT(!condition_write_hook);
+	memo_recording = entry;
+	condition_write_hook = MemoRecordWrite;
+	memo->rule_table->RunRule(rule);
+	condition_write_hook = 0;
+	memo_recording = 0;
+
+	entry->next_in_bucket = memo->buckets[hash & memo->bucket_mask];
+	memo->buckets[hash & memo->bucket_mask] = index;
+	MemoLruPushFront(memo, index);
+}
+
+f32 RuleMemoHitRate(RuleMemo* memo) {
+	u64 lookups = memo->hits + memo->misses;
+	return lookups ? (f32)memo->hits / (f32)lookups : 0.0f;
+}
+
+void RuleMemoReport(RuleMemo* memo) {
+	DINFO("Rule memo: %llu hits, %llu misses, %.1f%% hit rate, %llu evictions, %llu uncached runs",
+		(unsigned long long)memo->hits, (unsigned long long)memo->misses, RuleMemoHitRate(memo) * 100.0f,
+		(unsigned long long)memo->evictions, (unsigned long long)memo->uncacheable);
+}
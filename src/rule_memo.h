@@ -0,0 +1,59 @@
+#pragma once
+
+#define MEMO_MAX_INPUTS 16
+#define MEMO_KEY_SIZE 64
+#define MEMO_MAX_WRITES 8
+#define MEMO_STRING_BYTES 128
+
+//NOTE: the conditions a memoized rule reads, the rule has to be a pure function of these
+struct MemoRuleInputs {
+	ConditionRef inputs[MEMO_MAX_INPUTS];
+	u32 count;
+	b8 memoized;
+};
+
+//NOTE: increment writes hold the amount added and are replayed as an increment
+struct MemoWrite {
+	ConditionRef condition;
+	Value value;
+	b8 increment;
+};
+
+//NOTE: the writes a rule made for one tuple of input values. key is the inputs packed back to back,
+//strings in writes point into strings.
+struct MemoEntry {
+	RuleId rule;
+	u32 hash;
+	u32 key_size;
+	u8 key[MEMO_KEY_SIZE];
+	MemoWrite writes[MEMO_MAX_WRITES];
+	u32 write_count;
+	u8 strings[MEMO_STRING_BYTES];
+	u32 strings_used;
+	b8 overflowed;
+
+	u32 next_in_bucket;
+	u32 lru_prev;
+	u32 lru_next;
+};
+
+struct RuleMemo {
+	ConditionTables* tables;
+	RuleTable* rule_table;
+
+	MemoRuleInputs* rules;
+	u32 rule_capacity;
+
+	MemoEntry* entries;
+	u32 entry_count;
+	u32 entry_capacity;
+	u32* buckets;
+	u32 bucket_mask;
+	u32 lru_head;
+	u32 lru_tail;
+
+	u64 hits;
+	u64 misses;
+	u64 evictions;
+	u64 uncacheable;
+};
@@ -0,0 +1,327 @@
+#include "rule_reload.h"
+
+#define RELOAD_CHUNK_MEMORY (DEFAULT_CHUNK_SIZE + DEFAULT_CHUNK_SIZE * sizeof(i32) + DEFAULT_VALUE_ARRAY_CAPACITY * sizeof(Value) + DEFAULT_PROFILE_CAPACITY * sizeof(ConditionProfile))
+#define RELOAD_BLOCK_SIZE (RELOAD_MAX_RULE_SOURCE + RELOAD_CHUNK_MEMORY)
+
+//NOTE: the reader's epoch is stored before the set is loaded, so a reload that swaps the set after
+//this can't free it until the reader exits. Readers never wait on the reloading thread.
+RuleSet* RuleReloadEnter(RuleReload* reload, u32 reader) {
+	DASSERT(reader < RELOAD_MAX_READERS);
+	reload->readers[reader].epoch.store(reload->epoch.load());
+	return reload->current.load();
+}
+
+void RuleReloadExit(RuleReload* reload, u32 reader) {
+	reload->readers[reader].epoch.store(0, std::memory_order_release);
+}
+
+i32 RuleSetFind(RuleSet* set, u8* name, u32 length) {
+	u32 hash = HashBytes(name, length);
+	for (u32 slot = hash & set->lookup_mask; set->lookup[slot] != INVALID_ID; slot = (slot + 1) & set->lookup_mask) {
+		CompiledRule* rule = set->rules[set->lookup[slot]];
+		if (rule->name_hash == hash && StringsEqualN(rule->name, rule->name_length, name, length)) {
+			return set->lookup[slot];
+		}
+	}
+	return -1;
+}
+
+InterpretResult RuleSetRun(RuleSet* set, VM* vm, u32 rule) {
+	DASSERT(rule < set->rule_count);
+	return InterpretChunk(vm, &set->rules[rule]->chunk);
+}
+
+static void ReleaseCompiledRule(RuleReload* reload, CompiledRule* rule) {
+	PoolFree(&reload->blocks, rule->block);
+	rule->block = 0;
+	rule->next_free = reload->free_compiled;
+	reload->free_compiled = (u32)(rule - reload->compiled);
+}
+
+static void ReleaseRuleSet(RuleReload* reload, u32 set_index) {
+	RuleSet* set = reload->sets + set_index;
+	for (u32 i = 0; i < set->rule_count; i++) {
+		CompiledRule* rule = set->rules[i];
+		DASSERT(rule->set_count > 0);
+		if (--rule->set_count == 0) {
+			ReleaseCompiledRule(reload, rule);
+		}
+	}
+	set->rule_count = 0;
+	set->next_free = reload->free_set;
+	reload->free_set = set_index;
+}
+
+//NOTE: a retired set can go once every reader still inside entered after it was swapped out
+static void ReclaimRuleSets(RuleReload* reload) {
+	u64 oldest = UINT64_MAX;
+	for (u32 i = 0; i < RELOAD_MAX_READERS; i++) {
+		u64 epoch = reload->readers[i].epoch.load();
+		if (epoch != 0 && epoch < oldest) {
+			oldest = epoch;
+		}
+	}
+	u32 kept = 0;
+	for (u32 i = 0; i < reload->retired_count; i++) {
+		u32 set_index = reload->retired_sets[i];
+		if (reload->sets[set_index].retire_epoch <= oldest) {
+			ReleaseRuleSet(reload, set_index);
+		}
+		else {
+			reload->retired_sets[kept++] = set_index;
+		}
+	}
+	reload->retired_count = kept;
+}
+
+//NOTE: only the reloading thread waits here, and only when readers are holding on to every spare set
+static u32 AcquireRuleSet(RuleReload* reload) {
+	ReclaimRuleSets(reload);
+	while (reload->free_set == INVALID_ID) {
+		std::this_thread::yield();
+		ReclaimRuleSets(reload);
+	}
+	u32 set_index = reload->free_set;
+	reload->free_set = reload->sets[set_index].next_free;
+	return set_index;
+}
+
+static CompiledRule* AcquireCompiledRule(RuleReload* reload) {
+	CompiledRule* rule;
+	if (reload->free_compiled != INVALID_ID) {
+		rule = reload->compiled + reload->free_compiled;
+		reload->free_compiled = rule->next_free;
+	}
+	else {
+		DASSERT(reload->compiled_count < reload->compiled_capacity);
+		rule = reload->compiled + reload->compiled_count++;
+	}
+	rule->block = (u8*)PoolAlloc(&reload->blocks);
+	DASSERT(rule->block);
+	rule->set_count = 0;
+	return rule;
+}
+
+static b8 IsSpace(u8 c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+//NOTE: follows the script template, a rule's name on an unindented line and its condition on the
+//indented lines under it. Unindented lines starting with // are comments.
+static i32 SplitRuleScript(RuleReload* reload, u8* text, u32 size, RuleSpan* spans) {
+	i32 span_count = 0;
+	RuleSpan* span = 0;
+	u8* end = text + size;
+	for (u8* line = text; line < end;) {
+		u8* line_end = line;
+		while (line_end < end && *line_end != '\n') {
+			line_end++;
+		}
+		u8* trimmed_end = line_end;
+		while (trimmed_end > line && IsSpace(*(trimmed_end - 1))) {
+			trimmed_end--;
+		}
+		if (trimmed_end == line) {
+			//NOTE: blank line
+		}
+		else if (IsSpace(*line)) {
+			if (!span) {
+				DERROR("%s: condition before any rule name", reload->filename);
+				return -1;
+			}
+			if (!span->source) {
+				span->source = line;
+			}
+			span->source_length = (u32)(trimmed_end - span->source);
+		}
+		else if (trimmed_end - line < 2 || line[0] != '/' || line[1] != '/') {
+			if (span_count == (i32)reload->max_rules) {
+				DERROR("%s: more than %u rules", reload->filename, reload->max_rules);
+				return -1;
+			}
+			span = spans + span_count++;
+			*span = {line, (u32)(trimmed_end - line), 0, 0};
+		}
+		line = line_end + 1;
+	}
+	return span_count;
+}
+
+static b8 CompileRuleSpan(RuleReload* reload, RuleSpan* span, u32 name_hash, u32 source_hash, CompiledRule* rule) {
+	if (span->name_length + span->source_length + 1 > RELOAD_MAX_RULE_SOURCE) {
+		DERROR("%s: rule %.*s is too long", reload->filename, span->name_length, span->name);
+		return false;
+	}
+	rule->name = rule->block;
+	rule->name_length = span->name_length;
+	rule->name_hash = name_hash;
+	MemCopy(span->name, rule->name, span->name_length);
+	rule->source = rule->name + span->name_length;
+	rule->source_length = span->source_length;
+	rule->source_hash = source_hash;
+	MemCopy(span->source, rule->source, span->source_length);
+	rule->source[span->source_length] = '\0';
+
+	MemoryArena chunk_memory = {};
+	InitializeArena(&chunk_memory, RELOAD_CHUNK_MEMORY, rule->block + RELOAD_MAX_RULE_SOURCE);
+	InitChunk(&chunk_memory, &rule->chunk);
+	CompileOptions options = {};
+	options.registry = reload->registry;
+	if (!Compile(rule->source, &rule->chunk, &options)) {
+		DERROR("%s: rule %.*s failed to compile", reload->filename, span->name_length, span->name);
+		return false;
+	}
+	return true;
+}
+
+//NOTE: every rule whose name and text match a rule in the live set is shared rather than recompiled,
+//so the work done grows with the edit rather than the script. Nothing is published unless every
+//changed rule compiles, and condition values are never touched.
+b32 RuleReloadApply(RuleReload* reload) {
+	f64 start = PlatformGetSeconds();
+	DebugReadFileResult file = DebugPlatformReadEntireFile(reload->filename);
+	//NOTE: an empty script is treated as a failed read rather than dropping every rule
+	if (file.contents_size == 0) {
+		DebugPlatformFreeFileMemory(file.contents);
+		DERROR("Could not read %s", reload->filename);
+		return false;
+	}
+	TempMemory scratch = GetScratch();
+	RuleSpan* spans = PushArray(scratch.arena, reload->max_rules, RuleSpan);
+	i32 span_count = SplitRuleScript(reload, (u8*)file.contents, file.contents_size, spans);
+	if (span_count < 0) {
+		ReleaseScratch(scratch);
+		DebugPlatformFreeFileMemory(file.contents);
+		return false;
+	}
+
+	RuleSet* live = reload->current.load();
+	u32 set_index = AcquireRuleSet(reload);
+	RuleSet* set = reload->sets + set_index;
+	for (u32 i = 0; i <= set->lookup_mask; i++) {
+		set->lookup[i] = INVALID_ID;
+	}
+	set->rule_count = 0;
+	u32 compiled = 0;
+	b8 ok = true;
+	for (i32 i = 0; i < span_count && ok; i++) {
+		RuleSpan* span = spans + i;
+		if (!span->source) {
+			DERROR("%s: rule %.*s has no condition", reload->filename, span->name_length, span->name);
+			ok = false;
+			break;
+		}
+		u32 name_hash = HashBytes(span->name, span->name_length);
+		u32 source_hash = HashBytes(span->source, span->source_length);
+		CompiledRule* rule = 0;
+		i32 live_index = live ? RuleSetFind(live, span->name, span->name_length) : -1;
+		if (live_index >= 0) {
+			CompiledRule* live_rule = live->rules[live_index];
+			if (live_rule->source_hash == source_hash &&
+				StringsEqualN(live_rule->source, live_rule->source_length, span->source, span->source_length)) {
+				rule = live_rule;
+			}
+		}
+		if (!rule) {
+			rule = AcquireCompiledRule(reload);
+			compiled++;
+			if (!CompileRuleSpan(reload, span, name_hash, source_hash, rule)) {
+				ReleaseCompiledRule(reload, rule);
+				ok = false;
+				break;
+			}
+		}
+
+		u32 slot = name_hash & set->lookup_mask;
+		for (; set->lookup[slot] != INVALID_ID; slot = (slot + 1) & set->lookup_mask) {
+			CompiledRule* other = set->rules[set->lookup[slot]];
+			if (other->name_hash == name_hash && StringsEqualN(other->name, other->name_length, span->name, span->name_length)) {
+				DERROR("%s: rule %.*s is defined twice", reload->filename, span->name_length, span->name);
+				ok = false;
+				break;
+			}
+		}
+		//NOTE: set_count is what keeps a new rule alive, so a rejected set hands its new rules back here
+		rule->set_count++;
+		set->rules[set->rule_count] = rule;
+		if (ok) {
+			set->lookup[slot] = set->rule_count;
+		}
+		set->rule_count++;
+	}
+	ReleaseScratch(scratch);
+	DebugPlatformFreeFileMemory(file.contents);
+	if (!ok) {
+		ReleaseRuleSet(reload, set_index);
+		return false;
+	}
+
+	RuleSet* old = reload->current.exchange(set);
+	u64 epoch = reload->epoch.fetch_add(1) + 1;
+	if (old) {
+		old->retire_epoch = epoch;
+		reload->retired_sets[reload->retired_count++] = (u32)(old - reload->sets);
+	}
+	ReclaimRuleSets(reload);
+
+	reload->last_compiled = compiled;
+	reload->last_reused = set->rule_count - compiled;
+	reload->last_seconds = PlatformGetSeconds() - start;
+	DINFO("Loaded %s: %u rules compiled, %u reused in %.3f ms", reload->filename, reload->last_compiled, reload->last_reused, reload->last_seconds * 1000.0);
+	return true;
+}
+
+//NOTE: compile globals aren't thread safe, so Apply and Poll belong to one thread
+b32 RuleReloadInit(RuleReload* reload, MemoryArena* arena, ConditionRegistry* registry, char* filename, u32 max_rules) {
+	reload->registry = registry;
+	reload->filename = filename;
+	reload->max_rules = max_rules;
+	reload->current.store(0);
+	reload->epoch.store(1);
+	for (u32 i = 0; i < RELOAD_MAX_READERS; i++) {
+		reload->readers[i].epoch.store(0);
+	}
+
+	u32 lookup_count = RoundUpPowOf2(max_rules * 2);
+	reload->free_set = INVALID_ID;
+	for (u32 i = RELOAD_MAX_SETS; i-- > 0;) {
+		RuleSet* set = reload->sets + i;
+		set->rules = PushArray(arena, max_rules, CompiledRule*);
+		set->rule_count = 0;
+		set->lookup = PushArray(arena, lookup_count, u32);
+		set->lookup_mask = lookup_count - 1;
+		set->next_free = reload->free_set;
+		reload->free_set = i;
+	}
+	reload->retired_count = 0;
+
+	reload->compiled_capacity = max_rules * RELOAD_MAX_SETS;
+	reload->compiled = PushArray(arena, reload->compiled_capacity, CompiledRule);
+	reload->compiled_count = 0;
+	reload->free_compiled = INVALID_ID;
+	b32 reserved = PoolInitGrowing(&reload->blocks, reload->compiled_capacity, RELOAD_BLOCK_SIZE);
+	DASSERT(reserved);
+	ArenaRegister(&reload->blocks.slots, "rule blocks");
+
+	reload->watching = PlatformWatchFile(filename, &reload->watch);
+	if (!reload->watching) {
+		DWARN("Not watching %s, rules will only load once", filename);
+	}
+	return RuleReloadApply(reload);
+}
+
+//NOTE: call this from the reloading thread's loop, true when a new set was published
+b32 RuleReloadPoll(RuleReload* reload) {
+	if (!reload->watching || !PlatformFileChanged(&reload->watch)) {
+		ReclaimRuleSets(reload);
+		return false;
+	}
+	return RuleReloadApply(reload);
+}
+
+void RuleReloadStop(RuleReload* reload) {
+	if (reload->watching) {
+		PlatformUnwatchFile(&reload->watch);
+		reload->watching = false;
+	}
+}
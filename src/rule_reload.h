@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <thread>
+
+#define RELOAD_MAX_READERS 64
+//NOTE: the live set plus the ones retired but still possibly in use by a reader
+#define RELOAD_MAX_SETS 8
+#define RELOAD_MAX_RULE_SOURCE KiloBytes(4)
+
+//NOTE: one rule from the script and the chunk compiled from it. Constants in the chunk point into
+//source, so both live in the same block and go back on the free list together.
+struct CompiledRule {
+	u8* name;
+	u32 name_length;
+	u32 name_hash;
+	u8* source;
+	u32 source_length;
+	u32 source_hash;
+	Chunk chunk;
+	u8* block;
+	u32 set_count; //NOTE: rule sets that point at it, only the reloading thread touches this
+	u32 next_free;
+};
+
+//NOTE: rules in script order. A set is never changed once it's published, a reload builds a new one
+//that shares every rule whose source didn't change.
+struct RuleSet {
+	CompiledRule** rules;
+	u32 rule_count;
+	u32* lookup;
+	u32 lookup_mask;
+	u64 retire_epoch;
+	u32 next_free;
+};
+
+//NOTE: epoch the reader entered at, 0 while it isn't looking at a set
+struct alignas(64) RuleReader {
+	std::atomic<u64> epoch;
+};
+
+//NOTE: whatever was in the script between one rule name and the next
+struct RuleSpan {
+	u8* name;
+	u32 name_length;
+	u8* source;
+	u32 source_length;
+};
+
+struct RuleReload {
+	ConditionRegistry* registry;
+	char* filename;
+	FileWatch watch;
+	b32 watching;
+	u32 max_rules;
+
+	std::atomic<RuleSet*> current;
+	std::atomic<u64> epoch;
+	RuleReader readers[RELOAD_MAX_READERS];
+
+	RuleSet sets[RELOAD_MAX_SETS];
+	u32 free_set;
+	u32 retired_sets[RELOAD_MAX_SETS];
+	u32 retired_count;
+
+	CompiledRule* compiled;
+	u32 compiled_count;
+	u32 compiled_capacity;
+	u32 free_compiled;
+	Pool blocks;
+
+	u32 last_compiled;
+	u32 last_reused;
+	f64 last_seconds;
+};
+
+RuleSet* RuleReloadEnter(RuleReload* reload, u32 reader);
+void RuleReloadExit(RuleReload* reload, u32 reader);
+i32 RuleSetFind(RuleSet* set, u8* name, u32 length);
@@ -0,0 +1,241 @@
+#include "rule_scheduler.h"
+
+//NOTE: the read set the compiler gives a rule expression, every condition the bytecode loads
+u32 RuleAccessChunkReads(Chunk* chunk, ConditionRef* reads, u32 max_reads) {
+	u32 read_count = 0;
+	for (i32 offset = 0; offset < chunk->count;) {
+		u8 instruction = chunk->code[offset];
+		if (instruction == OP_GET_CONDITION) {
+			ConditionRef condition = {(ConditionTableType)chunk->code[offset + 1], (u32)(chunk->code[offset + 2] << 8) | chunk->code[offset + 3]};
+			b8 seen = false;
+			for (u32 i = 0; i < read_count && !seen; i++) {
+				seen = ConditionRefsEqual(reads[i], condition);
+			}
+			if (!seen) {
+				DASSERT(read_count < max_reads);
+				reads[read_count++] = condition;
+			}
+		}
+		switch (instruction) {
+			case OP_CONSTANT:
+			case OP_PROFILE:       offset += 2; break;
+			case OP_JUMP:
+			case OP_JUMP_IF_FALSE: offset += 3; break;
+			case OP_GET_CONDITION: offset += 4; break;
+			default:               offset += 1; break;
+		}
+	}
+	return read_count;
+}
+
+//NOTE: the latest waves that read and wrote a condition while the schedule is built
+struct ConditionWaves {
+	u32 key;
+	u32 last_read;
+	u32 last_write;
+};
+
+struct ConditionWaveMap {
+	ConditionWaves* slots;
+	u32 mask;
+};
+
+#define NO_WAVE 0
+//NOTE: strings share one buffer that moves when a string grows, so string writes conflict with
+//every other string access through this key as well as their own condition
+#define STRING_TABLE_KEY 0xFFFFFFFEu
+
+static ConditionWaves* ConditionWavesFor(ConditionWaveMap* map, u32 key) {
+	for (u32 slot = HashBytes(&key, sizeof(key)) & map->mask;; slot = (slot + 1) & map->mask) {
+		ConditionWaves* waves = map->slots + slot;
+		if (waves->key == key) {
+			return waves;
+		}
+		if (waves->key == INVALID_ID) {
+			*waves = {key, NO_WAVE, NO_WAVE};
+			return waves;
+		}
+	}
+}
+
+static u32 ConditionKey(ConditionRef condition) {
+	return ((u32)condition.table << 28) | condition.id;
+}
+
+//NOTE: a rule goes in the wave after the last earlier rule it conflicts with: read after write,
+//write after read and write after write. Waves are numbered from 1, 0 means no access yet.
+void RuleScheduleBuild(RuleSchedule* schedule, MemoryArena* arena, MemoryArena* scratch, RuleAccess* rules, u32 rule_count) {
+	TempMemory temp = BeginTempMemory(scratch);
+	u32 access_count = 0;
+	for (u32 i = 0; i < rule_count; i++) {
+		access_count += rules[i].read_count + rules[i].write_count;
+	}
+	ConditionWaveMap map = {};
+	u32 slot_count = RoundUpPowOf2(access_count * 2 + 2);
+	map.slots = PushArray(scratch, slot_count, ConditionWaves);
+	map.mask = slot_count - 1;
+	for (u32 i = 0; i < slot_count; i++) {
+		map.slots[i].key = INVALID_ID;
+	}
+
+	u32* rule_waves = PushArray(scratch, rule_count, u32);
+	u32 wave_count = 0;
+	for (u32 i = 0; i < rule_count; i++) {
+		RuleAccess* access = rules + i;
+		u32 wave = 1;
+		for (u32 r = 0; r < access->read_count; r++) {
+			wave = Maximum(wave, ConditionWavesFor(&map, ConditionKey(access->reads[r]))->last_write + 1);
+			if (access->reads[r].table == CONDITION_TABLE_STRING) {
+				wave = Maximum(wave, ConditionWavesFor(&map, STRING_TABLE_KEY)->last_write + 1);
+			}
+		}
+		for (u32 w = 0; w < access->write_count; w++) {
+			ConditionWaves* waves = ConditionWavesFor(&map, ConditionKey(access->writes[w]));
+			wave = Maximum(wave, Maximum(waves->last_write, waves->last_read) + 1);
+			if (access->writes[w].table == CONDITION_TABLE_STRING) {
+				ConditionWaves* string_waves = ConditionWavesFor(&map, STRING_TABLE_KEY);
+				wave = Maximum(wave, Maximum(string_waves->last_write, string_waves->last_read) + 1);
+			}
+		}
+		for (u32 r = 0; r < access->read_count; r++) {
+			ConditionWaves* waves = ConditionWavesFor(&map, ConditionKey(access->reads[r]));
+			waves->last_read = Maximum(waves->last_read, wave);
+			if (access->reads[r].table == CONDITION_TABLE_STRING) {
+				ConditionWaves* string_waves = ConditionWavesFor(&map, STRING_TABLE_KEY);
+				string_waves->last_read = Maximum(string_waves->last_read, wave);
+			}
+		}
+		for (u32 w = 0; w < access->write_count; w++) {
+			ConditionWavesFor(&map, ConditionKey(access->writes[w]))->last_write = wave;
+			if (access->writes[w].table == CONDITION_TABLE_STRING) {
+				ConditionWavesFor(&map, STRING_TABLE_KEY)->last_write = wave;
+			}
+		}
+		rule_waves[i] = wave;
+		wave_count = Maximum(wave_count, wave);
+	}
+
+	//counting sort by wave, stable so rules keep their given order inside a wave.
+	//wave w runs rules[wave_starts[w - 1]] up to rules[wave_starts[w]].
+	schedule->rules = PushArray(arena, rule_count, RuleId);
+	schedule->rule_count = rule_count;
+	schedule->wave_starts = PushArray(arena, wave_count + 1, u32);
+	schedule->wave_count = wave_count;
+	u32* fill = PushArray(scratch, wave_count, u32);
+	for (u32 wave = 0; wave < wave_count; wave++) {
+		fill[wave] = 0;
+	}
+	for (u32 i = 0; i < rule_count; i++) {
+		fill[rule_waves[i] - 1]++;
+	}
+	u32 start = 0;
+	for (u32 wave = 0; wave < wave_count; wave++) {
+		u32 count = fill[wave];
+		schedule->wave_starts[wave] = start;
+		fill[wave] = start;
+		start += count;
+	}
+	schedule->wave_starts[wave_count] = rule_count;
+	for (u32 i = 0; i < rule_count; i++) {
+		schedule->rules[fill[rule_waves[i] - 1]++] = rules[i].rule;
+	}
+	EndTempMemory(temp);
+}
+
+//NOTE: claims the next chunk of the current wave, from the worker's own range first and then from the others
+static b8 RuleWorkerClaim(RulePool* pool, u32 worker, u32* begin, u32* end) {
+	for (u32 i = 0; i < pool->worker_count; i++) {
+		RuleWorker* victim = pool->workers + (worker + i) % pool->worker_count;
+		if (victim->next.load(std::memory_order_relaxed) >= victim->end) {
+			continue;
+		}
+		u32 claimed = victim->next.fetch_add(RULE_STEAL_CHUNK, std::memory_order_relaxed);
+		if (claimed < victim->end) {
+			*begin = claimed;
+			*end = Minimum(claimed + RULE_STEAL_CHUNK, victim->end);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void RuleWorkerRunWave(RulePool* pool, u32 worker) {
+	u32 begin, end;
+	while (RuleWorkerClaim(pool, worker, &begin, &end)) {
+		for (u32 i = begin; i < end; i++) {
+			pool->rule_table->RunRule(pool->wave_rules[i]);
+		}
+	}
+	pool->busy_workers.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+static void RuleWorkerLoop(RulePool* pool, u32 worker) {
+	u64 done = 0;
+	for (;;) {
+		u64 wave = pool->wave.load(std::memory_order_acquire);
+		if (wave == done) {
+			if (pool->stopping.load(std::memory_order_acquire)) {
+				return;
+			}
+			std::this_thread::yield();
+			continue;
+		}
+		RuleWorkerRunWave(pool, worker);
+		done = wave;
+	}
+}
+
+//NOTE: the calling thread is worker 0, so thread_count threads are busy while a schedule runs
+void RulePoolStart(RulePool* pool, RuleTable* rule_table, u32 thread_count) {
+	DASSERT(thread_count > 0 && thread_count <= MAX_RULE_WORKERS);
+	pool->rule_table = rule_table;
+	pool->worker_count = thread_count;
+	pool->wave_rules = 0;
+	pool->wave.store(0);
+	pool->busy_workers.store(0);
+	pool->stopping.store(false);
+	for (u32 i = 0; i < thread_count; i++) {
+		pool->workers[i].next.store(0);
+		pool->workers[i].end = 0;
+	}
+	for (u32 i = 1; i < thread_count; i++) {
+		pool->workers[i].thread = std::thread(RuleWorkerLoop, pool, i);
+	}
+}
+
+//NOTE: waves run one after another, each split evenly over the workers and then balanced by stealing.
+//Rules in the same wave run at the same time so they must not share anything the tables don't keep apart,
+//attached indexes and growing strings included.
+void RulePoolRun(RulePool* pool, RuleSchedule* schedule) {
+	pool->wave_rules = schedule->rules;
+	for (u32 wave = 0; wave < schedule->wave_count; wave++) {
+		u32 begin = schedule->wave_starts[wave];
+		u32 end = schedule->wave_starts[wave + 1];
+		if (end - begin <= RULE_STEAL_CHUNK || pool->worker_count == 1) {
+			for (u32 i = begin; i < end; i++) {
+				pool->rule_table->RunRule(schedule->rules[i]);
+			}
+			continue;
+		}
+		u32 share = (end - begin + pool->worker_count - 1) / pool->worker_count;
+		for (u32 i = 0; i < pool->worker_count; i++) {
+			RuleWorker* worker = pool->workers + i;
+			worker->end = Minimum(begin + (i + 1) * share, end);
+			worker->next.store(Minimum(begin + i * share, end), std::memory_order_relaxed);
+		}
+		pool->busy_workers.store(pool->worker_count, std::memory_order_relaxed);
+		pool->wave.fetch_add(1, std::memory_order_release);
+		RuleWorkerRunWave(pool, 0);
+		while (pool->busy_workers.load(std::memory_order_acquire) != 0) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void RulePoolStop(RulePool* pool) {
+	pool->stopping.store(true, std::memory_order_release);
+	for (u32 i = 1; i < pool->worker_count; i++) {
+		pool->workers[i].thread.join();
+	}
+	pool->worker_count = 0;
+}
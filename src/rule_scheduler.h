@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <thread>
+
+#define MAX_RULE_WORKERS 64
+#define RULE_STEAL_CHUNK 64
+
+//NOTE: what a rule reads and writes. Reads can come from the compiler with RuleAccessChunkReads,
+//writes are declared by whoever registers the rule since rule funcs are opaque.
+struct RuleAccess {
+	RuleId rule;
+	ConditionRef* reads;
+	u32 read_count;
+	ConditionRef* writes;
+	u32 write_count;
+};
+
+//NOTE: rules grouped into waves, nothing in a wave conflicts with anything else in it and every
+//conflicting pair runs in the same order it was given in
+struct RuleSchedule {
+	RuleId* rules;
+	u32 rule_count;
+	u32* wave_starts;
+	u32 wave_count;
+};
+
+//NOTE: a worker's share of the current wave. The owner and thieves both claim chunks with a fetch-add
+//on next, so stealing needs no lock.
+struct alignas(64) RuleWorker {
+	std::atomic<u32> next;
+	u32 end;
+	std::thread thread;
+};
+
+struct RulePool {
+	RuleTable* rule_table;
+	RuleWorker workers[MAX_RULE_WORKERS];
+	u32 worker_count;
+
+	RuleId* wave_rules;
+	std::atomic<u64> wave;
+	std::atomic<u32> busy_workers;
+	std::atomic<b8> stopping;
+};
@@ -10,8 +10,7 @@ void InitScanner(u8* src) {
 static Token MakeToken(TokenTypeC type) {
 	Token token = {
 		.type = type,
-		.start = scanner.start,
-		.length = scanner.current - scanner.start,
+		.text = Str(scanner.start, (u32)(scanner.current - scanner.start)),
 		.line = scanner.line
 	};
 	return token;
@@ -20,8 +19,7 @@ static Token MakeToken(TokenTypeC type) {
 static Token ErrorToken(char* message) {
 	Token token = {
 		.type = TOKEN_ERROR,
-		.start = (u8*)message,
-		.length = StringLength((u8*)message),
+		.text = StringFromC(message),
 		.line = scanner.line
 	};
 	return token;
@@ -81,7 +79,7 @@ static void SkipWhiteSpace() {
 	}
 }
 
-static Token String() {
+static Token ScannerString() {
 	while (Peek() != '"' && !IsAtEnd()) {
 		if (Peek() == '\n')
 			scanner.line++;
@@ -94,12 +92,13 @@ static Token String() {
 }
 
 static TokenTypeC CheckKeyword(i32 start, i32 length, char* rest, TokenTypeC type) {
-	if (scanner.current - scanner.start == start + length && StringsEqual(scanner.start + start, (u8*)rest)) {
+	if (StringsEqualN(scanner.start + start, (u32)(scanner.current - scanner.start - start), (u8*)rest, length)) {
 		return type;
 	}
 	return TOKEN_IDENTIFIER;
 }
 
+//NOTE: literals without a fractional part are integers
 static Token ScannerNumber() {
 	while (IsDigit(Peek()))
 		scanner.current++;
@@ -107,12 +106,13 @@ static Token ScannerNumber() {
 		scanner.current++;
 		while (IsDigit(Peek()))
 			scanner.current++;
+		return MakeToken(TOKEN_NUMBER);
 	}
-	return MakeToken(TOKEN_NUMBER);
+	return MakeToken(TOKEN_INTEGER);
 }
 
 static TokenTypeC IdentifierType() {
-	switch (Peek()) {
+	switch (*scanner.start) {
 		case 'a': return CheckKeyword(1, 2, "nd", TOKEN_AND);
 		case 'i': return CheckKeyword(1, 1, "f", TOKEN_IF);
 		case 'o': return CheckKeyword(1, 1, "r", TOKEN_OR);
@@ -123,16 +123,15 @@ static TokenTypeC IdentifierType() {
 		case 'l': return CheckKeyword(1, 3, "ess", TOKEN_LESS);
 		case 'e': {
 			if (scanner.current - scanner.start > 1) {
-				switch (PeekNext()) {
+				switch (*(scanner.start + 1)) {
 					case 'l': return CheckKeyword(2, 2, "se", TOKEN_ELSE);
-					case 'q': return CheckKeyword(2, 4, "uals", TOKEN_ELSE);
+					case 'q': return CheckKeyword(2, 4, "uals", TOKEN_EQUAL_EQUAL);
 				}
 			}
-		
-		}
+		} break;
 		case 'n': {
 			if (scanner.current - scanner.start > 1) {
-				switch (PeekNext()) {
+				switch (*(scanner.start + 1)) {
 					case 'i': return CheckKeyword(2, 1, "l", TOKEN_NIL);
 					case 'o': return CheckKeyword(2, 1, "t", TOKEN_BANG);
 				}
@@ -140,7 +139,7 @@ static TokenTypeC IdentifierType() {
 		} break; 
 		case 'r': {
 			if (scanner.current - scanner.start > 1) {
-				switch (PeekNext()) {
+				switch (*(scanner.start + 1)) {
 					case 'e': return CheckKeyword(2, 4, "turn", TOKEN_RETURN);
 					case 'u': return CheckKeyword(2, 2, "le", TOKEN_RULE);
 				}
@@ -149,13 +148,14 @@ static TokenTypeC IdentifierType() {
 		} break;
 		case 'f': {
 			if (scanner.current - scanner.start > 1) {
-				switch (PeekNext()) {
+				switch (*(scanner.start + 1)) {
 					case 'a': return CheckKeyword(2, 3, "lse", TOKEN_FALSE);
 					case 'o': return CheckKeyword(2, 1, "r", TOKEN_FOR);
 				}
 			}
 		} break;
 	}
+	return TOKEN_IDENTIFIER;
 }
 
 static Token Identifier() {
@@ -166,12 +166,12 @@ static Token Identifier() {
 }
 
 static Token ScanToken() {
+	SkipWhiteSpace();
 	scanner.start = scanner.current;
 
 	if (IsAtEnd()) {
 		return MakeToken(TOKEN_EOF);
 	}
-	SkipWhiteSpace();
 	char c = ScannerAdvance();
 	if (IsAlpha(c))
 		return Identifier();
@@ -193,7 +193,7 @@ static Token ScanToken() {
 		case '=': return MakeToken(Match('=') ? TOKEN_EQUAL_EQUAL : TOKEN_EQUAL);
 		case '<': return MakeToken(Match('=') ? TOKEN_LESS_EQUAL : TOKEN_LESS);
 		case '>': return MakeToken(Match('=') ? TOKEN_GREATER_EQUAL : TOKEN_GREATER);
-		case '"': return String();
+		case '"': return ScannerString();
 		case '&': {
 			if (Match('&')) {
 				return MakeToken(TOKEN_AND);
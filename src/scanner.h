@@ -13,7 +13,7 @@ enum TokenTypeC {
 	TOKEN_LESS, TOKEN_LESS_EQUAL,
 
 	// Literals.
-	TOKEN_IDENTIFIER, TOKEN_STRING, TOKEN_NUMBER,
+	TOKEN_IDENTIFIER, TOKEN_STRING, TOKEN_NUMBER, TOKEN_INTEGER,
 
 	// Keywords.
 	TOKEN_AND, TOKEN_ELSE, TOKEN_FALSE, TOKEN_FOR, TOKEN_IF, TOKEN_NIL,
@@ -22,10 +22,10 @@ enum TokenTypeC {
 	TOKEN_ERROR, TOKEN_EOF
 };
 
+//NOTE: text is a view into the source, error tokens view their message instead
 struct Token {
 	TokenTypeC type;
-	u8* start;
-	i32 length;
+	String text;
 	i32 line;
 };
 
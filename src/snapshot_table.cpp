@@ -0,0 +1,411 @@
+#include "snapshot_table.h"
+
+//NOTE: copy-on-write paged table for one writer thread and many lock-free readers. Publishing a
+//version shares every page with it, the writer copies a page the first time it writes to it after that.
+//Readers announce the epoch they started in; anything retired in an epoch no active reader can still
+//be inside is reclaimed. A table either has epochs of its own or shares a group's, see ConditionSnapshots.
+struct SnapshotTable {
+	u32 element_size;
+	u32 elements_per_page;
+	u32 element_count;
+	u32 page_count;
+	u32 max_pages;
+
+	u8** write_pages;
+	b8* page_shared;
+	u8** replaced_pages;
+	u32 replaced_count;
+
+	u8* page_memory;
+	u32 page_memory_used;
+	u32 page_memory_capacity;
+	u8** free_pages;
+	u32 free_page_count;
+
+	SnapshotVersion versions[SNAPSHOT_MAX_VERSIONS];
+	u32 free_versions[SNAPSHOT_MAX_VERSIONS];
+	u32 free_version_count;
+
+	CircularArray<SnapshotRetired> retired;
+
+	std::atomic<SnapshotVersion*> published;
+	SnapshotEpochs* epochs;
+	SnapshotEpochs own_epochs;
+};
+
+void SnapshotReclaim(SnapshotTable* table);
+
+//NOTE: when readers pin every spare page the writer waits for them, readers themselves never wait
+static u8* SnapshotAllocPage(SnapshotTable* table) {
+	while (table->free_page_count == 0 && table->page_memory_used == table->page_memory_capacity) {
+		std::this_thread::yield();
+		SnapshotReclaim(table);
+	}
+	if (table->free_page_count > 0) {
+		return table->free_pages[--table->free_page_count];
+	}
+	u8* page = table->page_memory + (u64)table->page_memory_used * PAGE_SIZE;
+	CommitPage(page, 1);
+	table->page_memory_used++;
+	return page;
+}
+
+static void SnapshotRetire(SnapshotTable* table, u64 epoch, u8* page, SnapshotVersion* version) {
+	DASSERT(!CircularArrayIsFull(&table->retired));
+	CircularArrayPush(&table->retired, SnapshotRetired{epoch, page, version});
+}
+
+static u64 SnapshotOldestActive(SnapshotEpochs* epochs) {
+	u64 oldest_active = SNAPSHOT_READER_IDLE;
+	for (u32 i = 0; i < SNAPSHOT_MAX_READERS; i++) {
+		u64 active = epochs->readers[i].active_epoch.load();
+		oldest_active = Minimum(oldest_active, active);
+	}
+	return oldest_active;
+}
+
+static void SnapshotEpochsInit(SnapshotEpochs* epochs) {
+	for (u32 i = 0; i < SNAPSHOT_MAX_READERS; i++) {
+		epochs->readers[i].active_epoch.store(SNAPSHOT_READER_IDLE);
+	}
+	epochs->epoch.store(0);
+}
+
+//NOTE: writer side, frees everything retired before the oldest epoch a reader is still in
+void SnapshotReclaim(SnapshotTable* table) {
+	u64 oldest_active = SnapshotOldestActive(table->epochs);
+	while (!CircularArrayIsEmpty(&table->retired)) {
+		SnapshotRetired* next = table->retired.data + CircularArrayMask(&table->retired, table->retired.front);
+		if (next->epoch >= oldest_active) {
+			break;
+		}
+		SnapshotRetired entry = CircularArrayPop(&table->retired);
+		if (entry.page) {
+			table->free_pages[table->free_page_count++] = entry.page;
+		}
+		if (entry.version) {
+			table->free_versions[table->free_version_count++] = (u32)(entry.version - table->versions);
+		}
+	}
+}
+
+//NOTE: fills a version with the writer's current pages and marks them shared, so writes from here on copy
+//first. The version isn't visible to anyone until it's published.
+static SnapshotVersion* SnapshotTableFreeze(SnapshotTable* table) {
+	SnapshotReclaim(table);
+	while (table->free_version_count == 0) {
+		std::this_thread::yield();
+		SnapshotReclaim(table);
+	}
+	SnapshotVersion* version = table->versions + table->free_versions[--table->free_version_count];
+	version->element_count = table->element_count;
+	version->page_count = table->page_count;
+	MemCopy(table->write_pages, version->pages, table->page_count * sizeof(u8*));
+	for (u32 page = 0; page < table->page_count; page++) {
+		table->page_shared[page] = true;
+	}
+	return version;
+}
+
+//NOTE: the version a publish replaced and the pages copied since the one before, freed once no reader
+//is still in retire_epoch
+static void SnapshotTableRetire(SnapshotTable* table, SnapshotVersion* previous, u64 retire_epoch) {
+	if (previous) {
+		SnapshotRetire(table, retire_epoch, 0, previous);
+	}
+	for (u32 i = 0; i < table->replaced_count; i++) {
+		SnapshotRetire(table, retire_epoch, table->replaced_pages[i], 0);
+	}
+	table->replaced_count = 0;
+	SnapshotReclaim(table);
+}
+
+void SnapshotTablePublish(SnapshotTable* table) {
+	SnapshotVersion* version = SnapshotTableFreeze(table);
+	SnapshotVersion* previous = table->published.exchange(version);
+	u64 retire_epoch = table->epochs->epoch.fetch_add(1);
+	SnapshotTableRetire(table, previous, retire_epoch);
+}
+
+//NOTE: epochs is for tables published together, they all have to be published through the group
+void SnapshotTableInit(SnapshotTable* table, u32 element_size, u32 max_elements, SnapshotEpochs* epochs = 0) {
+	table->element_size = element_size;
+	table->elements_per_page = PAGE_SIZE / element_size;
+	table->element_count = 0;
+	table->page_count = 0;
+	table->max_pages = (max_elements + table->elements_per_page - 1) / table->elements_per_page;
+
+	//NOTE: the writer's page list, the shared flags, the pages replaced since the last publish and the
+	//free page stack all live in one block. The free stack is sized for every page in the pool.
+	table->page_memory_capacity = table->max_pages * 4;
+	u64 bookkeeping_size = (u64)table->max_pages * (2 * sizeof(u8*) + sizeof(b8)) + (u64)table->page_memory_capacity * sizeof(u8*);
+	u8* bookkeeping = (u8*)ReserveAndCommitPage(0, (u32)((bookkeeping_size + PAGE_SIZE - 1) / PAGE_SIZE));
+	table->write_pages = (u8**)bookkeeping;
+	table->replaced_pages = table->write_pages + table->max_pages;
+	table->free_pages = table->replaced_pages + table->max_pages;
+	table->page_shared = (b8*)(table->free_pages + table->page_memory_capacity);
+	table->replaced_count = 0;
+	table->free_page_count = 0;
+
+	table->page_memory = (u8*)ReservePage(0, table->page_memory_capacity);
+	table->page_memory_used = 0;
+
+	u64 version_pages_size = (u64)SNAPSHOT_MAX_VERSIONS * table->max_pages * sizeof(u8*);
+	u8** version_pages = (u8**)ReserveAndCommitPage(0, (u32)((version_pages_size + PAGE_SIZE - 1) / PAGE_SIZE));
+	for (u32 i = 0; i < SNAPSHOT_MAX_VERSIONS; i++) {
+		table->versions[i].pages = version_pages + (u64)i * table->max_pages;
+		table->free_versions[i] = SNAPSHOT_MAX_VERSIONS - 1 - i;
+	}
+	table->free_version_count = SNAPSHOT_MAX_VERSIONS;
+
+	u32 retired_capacity = 2;
+	while (retired_capacity < table->page_memory_capacity + SNAPSHOT_MAX_VERSIONS) {
+		retired_capacity <<= 1;
+	}
+	table->retired.capacity = retired_capacity;
+	table->retired.front = 0;
+	table->retired.back = 0;
+	table->retired.data = (SnapshotRetired*)ReserveAndCommitPage(0, (u32)((retired_capacity * sizeof(SnapshotRetired) + PAGE_SIZE - 1) / PAGE_SIZE));
+
+	if (epochs) {
+		table->epochs = epochs;
+	} else {
+		table->epochs = &table->own_epochs;
+		SnapshotEpochsInit(table->epochs);
+	}
+	table->published.store(0);
+	SnapshotTablePublish(table);
+}
+
+static u8* SnapshotWritableElement(SnapshotTable* table, u32 id) {
+	u32 page = id / table->elements_per_page;
+	if (table->page_shared[page]) {
+		u8* copy = SnapshotAllocPage(table);
+		MemCopy(table->write_pages[page], copy, PAGE_SIZE);
+		table->replaced_pages[table->replaced_count++] = table->write_pages[page];
+		table->write_pages[page] = copy;
+		table->page_shared[page] = false;
+	}
+	return table->write_pages[page] + (id % table->elements_per_page) * table->element_size;
+}
+
+//NOTE: writer side. Changes stay invisible to readers until the next SnapshotTablePublish.
+u32 SnapshotTableAppend(SnapshotTable* table, void* value) {
+	u32 id = table->element_count;
+	if (id % table->elements_per_page == 0) {
+		DASSERT(table->page_count < table->max_pages);
+		table->write_pages[table->page_count] = SnapshotAllocPage(table);
+		table->page_shared[table->page_count] = false;
+		table->page_count++;
+	}
+	table->element_count++;
+	MemCopy(value, SnapshotWritableElement(table, id), table->element_size);
+	return id;
+}
+
+void SnapshotTableSet(SnapshotTable* table, u32 id, void* value) {
+	DASSERT(id < table->element_count);
+	MemCopy(value, SnapshotWritableElement(table, id), table->element_size);
+}
+
+//NOTE: reader side, each reader thread passes its own slot index. The version stays valid until SnapshotEndRead.
+SnapshotVersion* SnapshotBeginRead(SnapshotTable* table, u32 reader) {
+	DASSERT(reader < SNAPSHOT_MAX_READERS);
+	table->epochs->readers[reader].active_epoch.store(table->epochs->epoch.load());
+	return table->published.load();
+}
+
+void SnapshotEndRead(SnapshotTable* table, u32 reader) {
+	table->epochs->readers[reader].active_epoch.store(SNAPSHOT_READER_IDLE, std::memory_order_release);
+}
+
+inline u8* SnapshotRead(SnapshotTable* table, SnapshotVersion* version, u32 id) {
+	DASSERT(id < version->element_count);
+	return version->pages[id / table->elements_per_page] + (id % table->elements_per_page) * table->element_size;
+}
+
+b8 SnapshotQueryCondition(SnapshotTable* table, SnapshotVersion* version, BoolConditionId condition) {
+	return *SnapshotRead(table, version, condition);
+}
+
+u8 SnapshotQueryCondition(SnapshotTable* table, SnapshotVersion* version, CharConditionId condition) {
+	return *SnapshotRead(table, version, condition);
+}
+
+f32 SnapshotQueryCondition(SnapshotTable* table, SnapshotVersion* version, FloatConditionId condition) {
+	return *(f32*)SnapshotRead(table, version, condition);
+}
+
+//NOTE: a snapshot table per condition table, kept in step with the live tables by the tables themselves.
+//The writer thread uses the tables as it always has and calls ConditionSnapshotsPublish when its writes
+//make a consistent state. Query threads read the last published state without taking any lock.
+struct ConditionSnapshots {
+	SnapshotTable tables[CONDITION_TABLE_COUNT];
+	SnapshotEpochs epochs;
+	std::atomic<ConditionSnapshot*> published;
+	ConditionSnapshot snapshots[SNAPSHOT_MAX_VERSIONS];
+	u32 free_snapshots[SNAPSHOT_MAX_VERSIONS];
+	u32 free_snapshot_count;
+	CircularArray<ConditionSnapshotRetired> retired;
+	ConditionSnapshotRetired retired_storage[SNAPSHOT_MAX_VERSIONS];
+};
+
+static u32 SnapshotElementSize(ConditionTableType table) {
+	switch (table) {
+		case CONDITION_TABLE_BOOL:   return sizeof(b8);
+		case CONDITION_TABLE_CHAR:   return sizeof(u8);
+		case CONDITION_TABLE_FLOAT:  return sizeof(f32);
+		case CONDITION_TABLE_STRING: return SNAPSHOT_STRING_SLOT_SIZE;
+		case CONDITION_TABLE_INT:    return sizeof(i64);
+		default: INVALID_CODE_PATH;
+	}
+	return 0;
+}
+
+static void ConditionSnapshotsReclaim(ConditionSnapshots* snapshots) {
+	u64 oldest_active = SnapshotOldestActive(&snapshots->epochs);
+	while (!CircularArrayIsEmpty(&snapshots->retired)) {
+		ConditionSnapshotRetired* next = snapshots->retired.data + CircularArrayMask(&snapshots->retired, snapshots->retired.front);
+		if (next->epoch >= oldest_active) {
+			break;
+		}
+		ConditionSnapshotRetired entry = CircularArrayPop(&snapshots->retired);
+		snapshots->free_snapshots[snapshots->free_snapshot_count++] = (u32)(entry.snapshot - snapshots->snapshots);
+	}
+}
+
+//NOTE: writer side. Every table gets a new version and readers switch to all of them with one exchange.
+void ConditionSnapshotsPublish(ConditionSnapshots* snapshots) {
+	ConditionSnapshotsReclaim(snapshots);
+	while (snapshots->free_snapshot_count == 0) {
+		std::this_thread::yield();
+		ConditionSnapshotsReclaim(snapshots);
+	}
+	ConditionSnapshot* snapshot = snapshots->snapshots + snapshots->free_snapshots[--snapshots->free_snapshot_count];
+	SnapshotVersion* previous_versions[CONDITION_TABLE_COUNT];
+	for (u32 table = 0; table < CONDITION_TABLE_COUNT; table++) {
+		snapshot->versions[table] = SnapshotTableFreeze(snapshots->tables + table);
+		previous_versions[table] = snapshots->tables[table].published.exchange(snapshot->versions[table]);
+	}
+
+	ConditionSnapshot* previous = snapshots->published.exchange(snapshot);
+	u64 retire_epoch = snapshots->epochs.epoch.fetch_add(1);
+	for (u32 table = 0; table < CONDITION_TABLE_COUNT; table++) {
+		SnapshotTableRetire(snapshots->tables + table, previous_versions[table], retire_epoch);
+	}
+	if (previous) {
+		DASSERT(!CircularArrayIsFull(&snapshots->retired));
+		CircularArrayPush(&snapshots->retired, ConditionSnapshotRetired{retire_epoch, previous});
+	}
+	ConditionSnapshotsReclaim(snapshots);
+}
+
+void ConditionSnapshotsInit(ConditionSnapshots* snapshots, u32 max_conditions) {
+	SnapshotEpochsInit(&snapshots->epochs);
+	for (u32 table = 0; table < CONDITION_TABLE_COUNT; table++) {
+		SnapshotTableInit(snapshots->tables + table, SnapshotElementSize((ConditionTableType)table), max_conditions, &snapshots->epochs);
+	}
+	for (u32 i = 0; i < SNAPSHOT_MAX_VERSIONS; i++) {
+		snapshots->snapshots[i].snapshots = snapshots;
+		snapshots->free_snapshots[i] = SNAPSHOT_MAX_VERSIONS - 1 - i;
+	}
+	snapshots->free_snapshot_count = SNAPSHOT_MAX_VERSIONS;
+	snapshots->retired.capacity = SNAPSHOT_MAX_VERSIONS;
+	snapshots->retired.front = 0;
+	snapshots->retired.back = 0;
+	snapshots->retired.data = snapshots->retired_storage;
+	snapshots->published.store(0);
+	ConditionSnapshotsPublish(snapshots);
+}
+
+static void PackSnapshotValue(ConditionTableType table, Value value, u8* element) {
+	switch (table) {
+		case CONDITION_TABLE_BOOL:   *element = (b8)AsBool(value); break;
+		case CONDITION_TABLE_CHAR:   *element = (u8)AsInt(value); break;
+		case CONDITION_TABLE_FLOAT:  *(f32*)element = AsNumber(value); break;
+		case CONDITION_TABLE_INT:    *(i64*)element = AsInt(value); break;
+		case CONDITION_TABLE_STRING: {
+			u32 length = AsStringLength(value);
+			DASSERT(length + 2 <= SNAPSHOT_STRING_SLOT_SIZE);
+			element[0] = (u8)length;
+			MemCopy(AsString(value), element + 1, length);
+			element[length + 1] = '\0';
+		} break;
+		default: INVALID_CODE_PATH;
+	}
+}
+
+//NOTE: called by the tables as conditions are added and written, readers see it after the next publish
+void SnapshotConditionAdded(ConditionSnapshots* snapshots, ConditionRef condition, Value value) {
+	u8 element[SNAPSHOT_STRING_SLOT_SIZE];
+	PackSnapshotValue(condition.table, value, element);
+	u32 id = SnapshotTableAppend(snapshots->tables + condition.table, element);
+	DASSERT(id == condition.id);
+}
+
+void SnapshotConditionSet(ConditionSnapshots* snapshots, ConditionRef condition, Value value) {
+	u8 element[SNAPSHOT_STRING_SLOT_SIZE];
+	PackSnapshotValue(condition.table, value, element);
+	SnapshotTableSet(snapshots->tables + condition.table, condition.id, element);
+}
+
+//NOTE: copies every condition the tables already hold, from then on the tables write through to the
+//snapshots. Publish once the copy should become visible.
+void ConditionSnapshotsAttach(ConditionSnapshots* snapshots, ConditionTables* tables) {
+	if (tables->bool_table) {
+		for (u32 id = 0; id < tables->bool_table->memory.used; id++) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_BOOL, id}, BoolVal(tables->bool_table->QueryCondition((BoolConditionId)id)));
+		}
+		tables->bool_table->snapshots = snapshots;
+	}
+	if (tables->char_table) {
+		for (u32 id = 0; id < tables->char_table->memory.used; id++) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_CHAR, id}, IntVal(tables->char_table->QueryCondition((CharConditionId)id)));
+		}
+		tables->char_table->snapshots = snapshots;
+	}
+	if (tables->float_table) {
+		for (u32 id = 0; id < tables->float_table->memory.used / sizeof(f32); id++) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_FLOAT, id}, NumberVal(tables->float_table->QueryCondition((FloatConditionId)id)));
+		}
+		tables->float_table->snapshots = snapshots;
+	}
+	if (tables->string_table) {
+		for (u32 id = 0; id < tables->string_table->look_aside_memory.used / sizeof(i32); id++) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_STRING, id}, StringVal(tables->string_table->QueryConditionString((StringConditionId)id)));
+		}
+		tables->string_table->snapshots = snapshots;
+	}
+	if (tables->int_table) {
+		for (u32 id = 0; id < tables->int_table->memory.used / sizeof(i64); id++) {
+			SnapshotConditionAdded(snapshots, {CONDITION_TABLE_INT, id}, IntVal(tables->int_table->QueryCondition((IntConditionId)id)));
+		}
+		tables->int_table->snapshots = snapshots;
+	}
+}
+
+//NOTE: reader side, like SnapshotBeginRead but one pin covers every table
+ConditionSnapshot* ConditionSnapshotsBeginRead(ConditionSnapshots* snapshots, u32 reader) {
+	DASSERT(reader < SNAPSHOT_MAX_READERS);
+	snapshots->epochs.readers[reader].active_epoch.store(snapshots->epochs.epoch.load());
+	return snapshots->published.load();
+}
+
+void ConditionSnapshotsEndRead(ConditionSnapshots* snapshots, u32 reader) {
+	snapshots->epochs.readers[reader].active_epoch.store(SNAPSHOT_READER_IDLE, std::memory_order_release);
+}
+
+//NOTE: same values QueryConditionValue gives for the live tables, strings point into the snapshot's pages
+Value QuerySnapshotValue(ConditionSnapshot* snapshot, ConditionRef condition) {
+	SnapshotTable* table = snapshot->snapshots->tables + condition.table;
+	u8* element = SnapshotRead(table, snapshot->versions[condition.table], condition.id);
+	switch (condition.table) {
+		case CONDITION_TABLE_BOOL:   return BoolVal(*element);
+		case CONDITION_TABLE_CHAR:   return IntVal(*element);
+		case CONDITION_TABLE_FLOAT:  return NumberVal(*(f32*)element);
+		case CONDITION_TABLE_STRING: return StringValN(element + 1, element[0]);
+		case CONDITION_TABLE_INT:    return IntVal(*(i64*)element);
+	}
+	INVALID_CODE_PATH;
+	return NilVal();
+}
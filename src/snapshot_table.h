@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <thread>
+
+#define SNAPSHOT_MAX_READERS 64
+#define SNAPSHOT_MAX_VERSIONS 64
+#define SNAPSHOT_READER_IDLE 0xFFFFFFFFFFFFFFFFull
+
+//NOTE: each reader thread owns one slot, kept on its own cache line so readers don't contend
+struct alignas(64) SnapshotReaderSlot {
+	std::atomic<u64> active_epoch;
+};
+
+//NOTE: the epoch readers announce themselves in. Tables published together share one, so a reader pins
+//every table's version with a single store.
+struct SnapshotEpochs {
+	std::atomic<u64> epoch;
+	SnapshotReaderSlot readers[SNAPSHOT_MAX_READERS];
+};
+
+//NOTE: an immutable view of the table, readers only ever see whole versions
+struct SnapshotVersion {
+	u32 element_count;
+	u32 page_count;
+	u8** pages;
+};
+
+//NOTE: a page or version the writer stopped using at epoch, freed once every reader has moved past it
+struct SnapshotRetired {
+	u64 epoch;
+	u8* page;
+	SnapshotVersion* version;
+};
+
+//NOTE: strings are stored as a length byte, the string and a terminator
+#define SNAPSHOT_STRING_SLOT_SIZE 256
+
+struct ConditionSnapshots;
+
+//NOTE: one version of every condition table, all from the same publish
+struct ConditionSnapshot {
+	ConditionSnapshots* snapshots;
+	SnapshotVersion* versions[CONDITION_TABLE_COUNT];
+};
+
+struct ConditionSnapshotRetired {
+	u64 epoch;
+	ConditionSnapshot* snapshot;
+};